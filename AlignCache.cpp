@@ -0,0 +1,64 @@
+#include "AlignCache.h"
+
+AlignCache::AlignCache(uint nSlotsIn) : nSlots(nSlotsIn) {
+    slot=new AlignCacheEntry [nSlots];
+    slotMutex=new pthread_mutex_t [(nSlots+ALIGN_CACHE_LOCK_SLOTS-1)/ALIGN_CACHE_LOCK_SLOTS];
+    for (uint ii=0; ii<(nSlots+ALIGN_CACHE_LOCK_SLOTS-1)/ALIGN_CACHE_LOCK_SLOTS; ii++) pthread_mutex_init(slotMutex+ii, NULL);
+};
+
+AlignCache::~AlignCache() {
+    for (uint ii=0; ii<(nSlots+ALIGN_CACHE_LOCK_SLOTS-1)/ALIGN_CACHE_LOCK_SLOTS; ii++) pthread_mutex_destroy(slotMutex+ii);
+    delete [] slotMutex;
+    delete [] slot;
+};
+
+uint AlignCache::slotIndex(const string &key) {//FNV-1a hash of the key, one slot per hash value: a new entry replaces the old one
+    uint h=14695981039346656037LLU;
+    for (uint ii=0; ii<key.size(); ii++) {
+        h ^= (unsigned char) key[ii];
+        h *= 1099511628211LLU;
+    };
+    return h % nSlots;
+};
+
+bool AlignCache::get(const string &key, AlignCacheRecord &rec, vector <Transcript> &trOut, intScore *trScoresOut) {
+    uint iS=slotIndex(key);
+    bool found=false;
+    pthread_mutex_lock(slotMutex+iS/ALIGN_CACHE_LOCK_SLOTS);
+    AlignCacheEntry *e=slot+iS;
+    if (e->key==key) {
+        found=true;
+        rec=e->rec;
+        if (trOut.size()<rec.nTr) trOut.resize(rec.nTr);
+        for (uint iTr=0; iTr<rec.nTr; iTr++) {
+            trOut[iTr]=*(e->tr[iTr]);
+            trScoresOut[iTr]=e->trScores[iTr];
+        };
+    };
+    pthread_mutex_unlock(slotMutex+iS/ALIGN_CACHE_LOCK_SLOTS);
+    return found;
+};
+
+void AlignCache::put(const string &key, const AlignCacheRecord &rec, Transcript **trIn, intScore *trScoresIn) {
+    uint iS=slotIndex(key);
+    uint arenaBytes=0;
+    for (uint iTr=0; iTr<rec.nTr; iTr++) arenaBytes += Transcript::compactBytes(*trIn[iTr]);
+
+    pthread_mutex_lock(slotMutex+iS/ALIGN_CACHE_LOCK_SLOTS);
+    AlignCacheEntry *e=slot+iS; //the entry overwrites the previous one in place, reusing its memory
+    e->key=key;
+    e->rec=rec;
+    e->trScores.assign(trScoresIn, trScoresIn+rec.nTr);
+    e->tr.resize(rec.nTr);
+    e->arena.reserve(arenaBytes);
+    for (uint iTr=0; iTr<rec.nTr; iTr++) e->tr[iTr]=Transcript::newCompact(*trIn[iTr], e->arena);
+    pthread_mutex_unlock(slotMutex+iS/ALIGN_CACHE_LOCK_SLOTS);
+};
+
+void AlignCache::clear() {
+    for (uint ii=0; ii<nSlots; ii++) {
+        slot[ii].key.clear();
+        slot[ii].tr.clear();
+        slot[ii].arena.reset();
+    };
+};
@@ -0,0 +1,40 @@
+#ifndef DEF_AlignCache
+#define DEF_AlignCache
+
+#include "IncludeDefine.h"
+#include "Transcript.h"
+#include "ReadArena.h"
+#include <pthread.h>
+
+#define ALIGN_CACHE_LOCK_SLOTS 1024 //number of slots protected by one mutex
+
+struct AlignCacheRecord {//the read-level results of multMapSelect
+    uint nW, nTr, nTrMate, iTrBest;
+    intScore maxScore;
+};
+
+class AlignCacheEntry {//finalized alignments of one read sequence, the transcripts are compact copies in the entry arena
+    public:
+        string key; //empty: the slot is not used
+        AlignCacheRecord rec;
+        vector <intScore> trScores;
+        vector <Transcript*> tr;
+        ReadArena arena; //the memory of the slot is reused by the following entries, it grows only for a larger entry
+        AlignCacheEntry() : arena(0) {};
+};
+
+class AlignCache {//bounded cache of the alignments of the duplicate reads, shared by all mapping threads
+    public:
+        AlignCache(uint nSlotsIn);
+        ~AlignCache();
+        bool get(const string &key, AlignCacheRecord &rec, vector <Transcript> &trOut, intScore *trScoresOut); //full copies of the cached transcripts into trOut[0...rec.nTr)
+        void put(const string &key, const AlignCacheRecord &rec, Transcript **trIn, intScore *trScoresIn); //replaces the entry in the slot of the key
+        void clear(); //remove all entries, the memory of the slots is kept; not thread-safe
+    private:
+        uint nSlots;
+        AlignCacheEntry *slot; //preallocated entries, one per slot
+        pthread_mutex_t *slotMutex;
+        uint slotIndex(const string &key);
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "BAMfunctions.h"
+#include <zlib.h>
 
 void outBAMwriteHeader (BGZF* fp, const string &samh, const vector <string> &chrn, const vector <uint> &chrl) {
     bgzf_write(fp,"BAM\001",4);
@@ -15,4 +16,45 @@ void outBAMwriteHeader (BGZF* fp, const string &samh, const vector <string> &chr
         bgzf_write(fp,(char*) &slen,sizeof(slen));
     };
     bgzf_flush(fp);
-};
\ No newline at end of file
+};
+
+uint bgzfCompressBlocks (const char* bamIn, uint bamInSize, char* bgzfOut, int compressionLevel) {
+    //compress bamIn into a series of complete BGZF blocks in bgzfOut, returns the number of compressed bytes
+    //bgzfOut has to be at least bgzfCompressBlocksMaxSize(bamInSize) long
+    //this is called by each thread outside of the output mutex, so that compression runs in parallel
+    const uint headerL=18, footerL=8;
+    const char bgzfHeader[headerL]={31,(char)139,8,4, 0,0,0,0, 0,(char)255, 6,0, 66,67, 2,0, 0,0};
+
+    z_stream zs;
+    zs.zalloc=Z_NULL;
+    zs.zfree=Z_NULL;
+    zs.opaque=Z_NULL;
+    if (deflateInit2(&zs, compressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return 0; //-15: raw deflate, no zlib header
+
+    uint bgzfOutSize=0;
+    for (uint inStart=0; inStart<bamInSize; inStart+=BGZF_BLOCK_SIZE) {
+        uint32 inL=(uint32) min(bamInSize-inStart, (uint) BGZF_BLOCK_SIZE);
+        char *block1=bgzfOut+bgzfOutSize;
+
+        deflateReset(&zs);
+        zs.next_in=(Bytef*) (bamIn+inStart);
+        zs.avail_in=inL;
+        zs.next_out=(Bytef*) (block1+headerL);
+        zs.avail_out=BGZF_MAX_BLOCK_SIZE-headerL-footerL;
+        if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+            deflateEnd(&zs);
+            return 0;
+        };
+        uint16 blockL=(uint16) (zs.total_out+headerL+footerL-1); //BSIZE is the block size minus 1
+
+        memcpy(block1,bgzfHeader,headerL);
+        memcpy(block1+16,&blockL,sizeof(blockL));
+        uint32 crc=crc32(crc32(0L,Z_NULL,0), (Bytef*) (bamIn+inStart), inL);
+        memcpy(block1+headerL+zs.total_out,&crc,sizeof(crc));
+        memcpy(block1+headerL+zs.total_out+sizeof(crc),&inL,sizeof(inL));
+
+        bgzfOutSize+=blockL+1;
+    };
+    deflateEnd(&zs);
+    return bgzfOutSize;
+};
@@ -4,5 +4,9 @@
 #include "IncludeDefine.h"
 #include SAMTOOLS_BGZF_H
         void outBAMwriteHeader (BGZF* fp, const string &samh, const vector <string> &chrn, const vector <uint> &chrl);
+        uint bgzfCompressBlocks (const char* bamIn, uint bamInSize, char* bgzfOut, int compressionLevel);
+        inline uint bgzfCompressBlocksMaxSize (uint bamInSize) {//max size of the compressed output for bgzfCompressBlocks
+            return (bamInSize/BGZF_BLOCK_SIZE+1)*BGZF_MAX_BLOCK_SIZE;
+        };
         
 #endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "BAMoutput.h"
+#include "ErrorWarning.h"
+#include <sys/stat.h>
+
+BAMoutput::BAMoutput (int iChunk, Parameters *Pin) {//allocate bins and create the directory for bin files
+    P=Pin;
+
+    binN=P->outBAMsortingBinsN+1;//last bin is for unmapped reads
+    binWidth=P->nGenome/P->outBAMsortingBinsN+1;
+    binSize=P->chunkOutSAMsizeBytes/binN;
+
+    binArray=new char [binSize*binN];
+    binStart=new char* [binN];
+    binBytes=new uint [binN];
+    binTotalBytes=new uint [binN];
+    binTotalN=new uint [binN];
+    for (uint ii=0;ii<binN;ii++) {
+        binStart[ii]=binArray+ii*binSize;
+        binBytes[ii]=0;
+        binTotalBytes[ii]=0;
+        binTotalN[ii]=0;
+    };
+
+    binDir=P->outFileTmp+"/BAMsort/"+to_string((uint) iChunk)+"/";
+    mkdir((P->outFileTmp+"/BAMsort/").c_str(),S_IRWXU);
+    mkdir(binDir.c_str(),S_IRWXU);
+};
+
+void BAMoutput::coordOneAlign (char *bamIn, uint bamSize, uint iRead) {
+    //each record in the bin is followed by the read number, which is used to break ties in sorting
+    uint32 *bamIn32=(uint32*) bamIn;
+    uint iBin;
+    if (bamIn32[1] == ((uint32) -1) ) {//unmapped
+        iBin=binN-1;
+    } else {
+        iBin=(P->chrStart[bamIn32[1]]+bamIn32[2])/binWidth;
+    };
+
+    if (binBytes[iBin]+bamSize+sizeof(uint) > binSize) coordBinFlush(iBin);
+
+    if (bamSize+sizeof(uint) > binSize) {//record does not fit into the buffer, write directly to disk
+        ofstream binFile((binDir+to_string(iBin)).c_str(), ios::app | ios::binary);
+        binFile.write(bamIn,bamSize);
+        binFile.write((char*) &iRead,sizeof(uint));
+        binFile.close();
+    } else {
+        memcpy(binStart[iBin]+binBytes[iBin],bamIn,bamSize);
+        memcpy(binStart[iBin]+binBytes[iBin]+bamSize,&iRead,sizeof(uint));
+        binBytes[iBin]+=bamSize+sizeof(uint);
+    };
+    binTotalBytes[iBin]+=bamSize+sizeof(uint);
+    binTotalN[iBin]++;
+};
+
+void BAMoutput::coordBinFlush (uint iBin) {//bin files are re-opened for each flush to keep the number of open files small
+    if (binBytes[iBin]==0) return;
+    ofstream binFile((binDir+to_string(iBin)).c_str(), ios::app | ios::binary);
+    binFile.write(binStart[iBin],binBytes[iBin]);
+    if (binFile.fail()) {
+        ostringstream errOut;
+        errOut <<"EXITING because of fatal ERROR: could not write BAM sorting bin file " << binDir+to_string(iBin) <<"\n";
+        errOut <<"SOLUTION: check that the disk is not full and you have permission to write into " << P->outFileTmp <<"\n";
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+    };
+    binFile.close();
+    binBytes[iBin]=0;
+};
+
+void BAMoutput::coordFlush () {
+    for (uint iBin=0;iBin<binN;iBin++) coordBinFlush(iBin);
+};
@@ -0,0 +1,27 @@
+#ifndef DEF_BAMoutput
+#define DEF_BAMoutput
+
+#include "IncludeDefine.h"
+#include "Parameters.h"
+
+class BAMoutput {//BAM output for one thread: binning of the alignments by coordinate into temporary files
+public:
+    uint binN; //number of coordinate bins, the last bin is reserved for unmapped reads
+    uint binWidth; //genomic width of one bin
+    uint binSize; //size of the buffer for each bin
+    char **binStart; //pointers to the start of each bin buffer
+    uint *binBytes; //bytes stored in the bin buffers
+    uint *binTotalBytes, *binTotalN; //total bytes and number of records written for each bin, including the ones flushed to disk
+    string binDir; //directory for the bin files of this thread
+
+    BAMoutput (int iChunk, Parameters *Pin);
+    void coordOneAlign (char *bamIn, uint bamSize, uint iRead); //add one alignment to its bin
+    void coordBinFlush (uint iBin); //write one bin buffer to disk
+    void coordFlush (); //write all bin buffers to disk
+
+private:
+    char *binArray; //memory for all bins
+    Parameters *P;
+};
+
+#endif
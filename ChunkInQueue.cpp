@@ -0,0 +1,155 @@
+#include "ChunkInQueue.h"
+#include "GlobalVariables.h"
+#include "ErrorWarning.h"
+
+#define CHUNK_IN_QUEUE_N 2 //number of chunks that can be loaded ahead of the mapping threads
+
+ChunkInQueue::ChunkInQueue (Parameters *Pin) : P(Pin) {
+    queueN=CHUNK_IN_QUEUE_N;
+    fullChunk=new char** [queueN];
+    freeChunk=new char** [queueN];
+    fullChunkI=new uint [queueN];
+    for (uint ic=0;ic<queueN;ic++) {
+        freeChunk[ic]=new char* [P->readNmates];
+        for (uint imate=0;imate<P->readNmates;imate++) {
+            freeChunk[ic][imate]=new char[P->chunkInSizeBytesArray];
+            memset(freeChunk[ic][imate],'\n',P->chunkInSizeBytesArray);
+        };
+    };
+    freeN=queueN;
+    fullStart=0;
+    fullN=0;
+    readingDone=false;
+
+    pthread_mutex_init(&mutexQueue, NULL);
+    pthread_cond_init(&condFull, NULL);
+    pthread_cond_init(&condFree, NULL);
+};
+
+void ChunkInQueue::startReading() {
+    int threadStatus=pthread_create(&threadRead, NULL, &threadReadChunks, (void *) this);
+    if (threadStatus) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not create the input reads thread, error code: " << threadStatus;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+    };
+};
+
+void ChunkInQueue::finishReading() {
+    int threadJoinStatus=pthread_join(threadRead, NULL);
+    if (threadJoinStatus) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: phtread error while joining the input reads thread, error code: " << threadJoinStatus;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+    };
+};
+
+bool ChunkInQueue::getChunk(char** chunkIn, uint &iChunkIn) {//the buffers of the previous chunk are returned into the queue
+    pthread_mutex_lock(&mutexQueue);
+    while (fullN==0 && !readingDone) pthread_cond_wait(&condFull, &mutexQueue);
+
+    if (fullN==0) {//no more reads: empty chunk
+        iChunkIn=g_threadChunks.chunkInN;
+        g_threadChunks.chunkInN++;
+        pthread_mutex_unlock(&mutexQueue);
+        for (uint imate=0; imate<P->readNmates; imate++) chunkIn[imate][0]='\n';
+        return false;
+    };
+
+    char** chunk1=fullChunk[fullStart];
+    iChunkIn=fullChunkI[fullStart];
+    fullStart=(fullStart+1)%queueN;
+    fullN--;
+
+    for (uint imate=0; imate<P->readNmates; imate++) {//swap buffers
+        char* buf1=chunkIn[imate];
+        chunkIn[imate]=chunk1[imate];
+        chunk1[imate]=buf1;
+    };
+    freeChunk[freeN]=chunk1;
+    freeN++;
+    pthread_cond_signal(&condFree);
+    pthread_mutex_unlock(&mutexQueue);
+    return true;
+};
+
+void ChunkInQueue::readChunks() {
+    while (true) {
+        pthread_mutex_lock(&mutexQueue);
+        while (freeN==0) pthread_cond_wait(&condFree, &mutexQueue);
+        freeN--;
+        char** chunk1=freeChunk[freeN];
+        pthread_mutex_unlock(&mutexQueue);
+
+        uint chunkBytes=readChunk(chunk1); //load outside of the lock
+
+        pthread_mutex_lock(&mutexQueue);
+        if (chunkBytes==0) {//end of input
+            freeChunk[freeN]=chunk1;
+            freeN++;
+            readingDone=true;
+            pthread_cond_broadcast(&condFull);
+            pthread_mutex_unlock(&mutexQueue);
+            break;
+        };
+        uint iFull=(fullStart+fullN)%queueN;
+        fullChunk[iFull]=chunk1;
+        fullChunkI[iFull]=g_threadChunks.chunkInN;
+        g_threadChunks.chunkInN++;
+        fullN++;
+        pthread_cond_signal(&condFull);
+        pthread_mutex_unlock(&mutexQueue);
+    };
+};
+
+uint ChunkInQueue::readChunk(char** chunkIn) {
+    uint chunkInSizeBytesTotal[2]={0,0};
+    uint lineLengthMax=max((uint) DEF_readNameLengthMax, P->limitReadSeqLength); //name or sequence line
+    while (chunkInSizeBytesTotal[0] < P->chunkInSizeBytes && chunkInSizeBytesTotal[1] < P->chunkInSizeBytes && !P->inOut->readIn[0]->eof() && (P->readNmates==1 || !P->inOut->readIn[1]->eof())) {
+        char nextChar=P->inOut->readIn[0]->peek();
+        if (nextChar=='@') {//fastq, not multi-line
+            P->iReadAll++; //increment read number
+            for (uint imate=0; imate<P->readNmates; imate++) {
+                int iline=0;
+                if (P->outSAMreadID=="Number") {
+                    P->inOut->readIn[imate]->ignore(lineLengthMax,'\n');
+                    chunkInSizeBytesTotal[imate] += sprintf(chunkIn[imate] + chunkInSizeBytesTotal[imate], "@%.llu\n", P->iReadAll);
+                    iline=1;
+                };
+                for (;iline<4;iline++) {
+                    P->inOut->readIn[imate]->getline(chunkIn[imate] + chunkInSizeBytesTotal[imate], lineLengthMax+1 );
+                    chunkInSizeBytesTotal[imate] += P->inOut->readIn[imate]->gcount();
+                    chunkIn[imate][chunkInSizeBytesTotal[imate]-1]='\n';
+                };
+            };
+        } else if (nextChar=='>') {//fasta, can be multiline, which is converted to single line
+            for (uint imate=0; imate<P->readNmates; imate++) {
+                //read read name
+                P->inOut->readIn[imate]->getline(chunkIn[imate] + chunkInSizeBytesTotal[imate], DEF_readNameLengthMax+1 );
+                if (P->inOut->readIn[imate]->gcount()<2) break; //no more input
+                chunkInSizeBytesTotal[imate] += P->inOut->readIn[imate]->gcount();
+                chunkIn[imate][chunkInSizeBytesTotal[imate]-1]='\n';
+                nextChar=P->inOut->readIn[imate]->peek();
+                while (nextChar!='@' && nextChar!='>' && nextChar!=' ' && nextChar!='\n' && !P->inOut->readIn[0]->eof()) {//read multi-line fasta
+                    P->inOut->readIn[imate]->getline(chunkIn[imate] + chunkInSizeBytesTotal[imate], P->limitReadSeqLength + 1 );
+                    if (P->inOut->readIn[imate]->gcount()<2) break; //no more input
+                    chunkInSizeBytesTotal[imate] += P->inOut->readIn[imate]->gcount()-1;
+                    nextChar=P->inOut->readIn[imate]->peek();
+                };
+                chunkIn[imate][chunkInSizeBytesTotal[imate]]='\n';
+                chunkInSizeBytesTotal[imate] ++;
+            };
+        } else if (nextChar==' ' || nextChar=='\n' || P->inOut->readIn[0]->eof()) {//end of stream
+            break;
+        } else {//error
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR in input reads: unknown file format: the read ID should start with @ or > \n";
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+        };
+    };
+    //TODO: check here that both mates are zero or non-zero
+
+    for (uint imate=0; imate<P->readNmates; imate++) chunkIn[imate][chunkInSizeBytesTotal[imate]]='\n';//extra empty line at the end of the chunks
+
+    return chunkInSizeBytesTotal[0];
+};
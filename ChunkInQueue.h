@@ -0,0 +1,36 @@
+#ifndef DEF_ChunkInQueue
+#define DEF_ChunkInQueue
+
+#include "IncludeDefine.h"
+#include "Parameters.h"
+#include <pthread.h>
+
+class ChunkInQueue {//bounded queue of input read chunks: filled by a dedicated reader thread, consumed by the mapping threads
+public:
+    ChunkInQueue (Parameters *Pin);
+    void startReading(); //start the reader thread
+    void finishReading(); //wait for the reader thread to finish
+    bool getChunk(char** chunkIn, uint &iChunkIn); //swap chunkIn buffers with the next filled chunk; false if there are no reads left
+
+private:
+    Parameters *P;
+
+    uint queueN; //number of chunk buffers in the queue
+    char ***fullChunk, ***freeChunk; //[queueN][readNmates] buffers: ring of filled chunks, stack of free chunks
+    uint *fullChunkI; //chunk numbers of the filled chunks
+    uint fullStart, fullN, freeN;
+    bool readingDone;
+
+    pthread_t threadRead;
+    pthread_mutex_t mutexQueue;
+    pthread_cond_t condFull, condFree;
+
+    uint readChunk(char** chunkIn); //load one chunk from the input files, returns the number of bytes loaded for the 1st mate
+    void readChunks(); //reader thread: load chunks until the end of input
+    static void* threadReadChunks(void *Q) {
+        ( (ChunkInQueue*) Q )->readChunks();
+        return NULL;
+    };
+};
+
+#endif
@@ -4,20 +4,44 @@
 #include "PackedArray.h"
 #include "ErrorWarning.h"
 #include "streamFuns.h"
+#include "NumaFuns.h"
+#include "GenomeIndexFile.h"
+#include "GenomePacked.h"
 #include <time.h>
 #include <cmath>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <omp.h>
+#include <pthread.h>
+#include <signal.h>
 
 #define SHM_sizeG 0
 #define SHM_sizeSA 8
-#define SHM_startG 16
+#define SHM_sync 16
+#define SHM_startG 256
 #define SHM_projectID 23
+#define SHM_syncMagic 0x52415453 //marks the initialized synchronization header
+
+struct GenomeShmSync {//synchronization of the jobs sharing the genome, in the shared memory header
+    volatile uint32 syncReady; //SHM_syncMagic after mutexLoad is initialized
+    pthread_mutex_t mutexLoad; //process-shared, robust: locked by the loading job until the genome is loaded
+};
+static_assert(SHM_sync+sizeof(GenomeShmSync)<=SHM_startG, "GenomeShmSync does not fit into the shared memory header");
+
+#ifndef MAP_HUGE_SHIFT //huge page size encoding for mmap and shmget, may be missing in older headers
+    #define MAP_HUGE_SHIFT 26
+#endif
+#ifndef SHM_HUGE_SHIFT
+    #define SHM_HUGE_SHIFT 26
+#endif
 
 // Genome::Genome(Parameters* Pin) {
 //     P=Pin;
 // };
 
-Genome::~Genome() {
+void Genome::genomeRelease() {
     P->inOut->logMain << "--genomeLoad=" << P->genomeLoad <<" ."<<endl;
     if (P->genomeLoad=="LoadAndRemove") {//mark genome for removal after the jobs complete, if there are no other jobs attached to it
         struct shmid_ds shmStat;
@@ -31,8 +55,304 @@ Genome::~Genome() {
     }; 
 };
 
+static char* genomeFileMmap(Parameters* P, const string &fileName, uint &fileBytes, uint padBefore, uint padAfter, bool writePad) {
+    //map the genome file read-only, with padBefore/padAfter bytes of private memory around it
+    //returns the pointer to the start of the file; if writePad, the last page of the file is writable (copied on write) to fill the padding
+    int fileFD=open(fileName.c_str(),O_RDONLY);
+    struct stat fileStat;
+    if (fileFD<0 || fstat(fileFD,&fileStat)!=0) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not open genome file "<< fileName <<" : "<< strerror(errno) <<"\n";
+        errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n" <<flush;     
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+    };
+    fileBytes=(uint) fileStat.st_size;
+
+    uint pageBytes=(uint) sysconf(_SC_PAGESIZE);
+    uint beforeBytes=(padBefore+pageBytes-1)/pageBytes*pageBytes;
+    uint mapBytes=(fileBytes+padAfter+pageBytes-1)/pageBytes*pageBytes;
+    //reserve the address space, the file is mapped on top of it: the padding is private memory, and the bytes past the end of the file are accessible
+    char *mapStart=(char*) mmap(NULL, beforeBytes+mapBytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    char *fileStart=mapStart+beforeBytes;
+    if (mapStart!=MAP_FAILED && fileBytes>0) {
+        int mapFlags=MAP_PRIVATE|MAP_FIXED|(P->genomeMmapPopulate=="Yes" ? MAP_POPULATE : 0);
+        if (mmap(fileStart, fileBytes, PROT_READ|(writePad ? PROT_WRITE : 0), mapFlags, fileFD, 0)==MAP_FAILED) mapStart=(char*) MAP_FAILED;
+    };
+    if (mapStart==MAP_FAILED) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not map genome file "<< fileName <<" into memory, error from mmap(): "<< strerror(errno) <<"\n";
+        errOut << "SOLUTION: check that the virtual memory is not limited with ulimit -v, OR run STAR with --genomeLoad NoSharedMemory\n" <<flush;     
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_MemoryAllocation, *P);
+    };
+    close(fileFD); //the mapping stays valid
+
+    int advice=-1;
+    if (P->genomeMmapAdvise=="Random") {
+        advice=MADV_RANDOM;
+    } else if (P->genomeMmapAdvise=="Sequential") {
+        advice=MADV_SEQUENTIAL;
+    } else if (P->genomeMmapAdvise=="WillNeed") {
+        advice=MADV_WILLNEED;
+    };
+    if (advice>=0 && fileBytes>0 && madvise(fileStart, fileBytes, advice)!=0) {
+        P->inOut->logMain << "WARNING: madvise() failed for the genome file " << fileName <<" : "<< strerror(errno) <<"\n"<<flush;
+    };
+
+    P->inOut->logMain << "Mapped genome file " << fileName << " : " << fileBytes << " bytes\n"<<flush;
+    return fileStart;
+};
+
+static void genomeShmLoadStart(Parameters* P, char* shmStart) {
+    //initialize the synchronization header and lock it for the time of loading; it is unlocked by genomeShmLoadFinish
+    GenomeShmSync *shmSync=(GenomeShmSync*) (shmStart+SHM_sync);
+    pthread_mutexattr_t mutexAttr;
+    pthread_mutexattr_init(&mutexAttr);
+    pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST); //the lock is released by the kernel if this job dies while loading
+    int mutexStatus=pthread_mutex_init(&shmSync->mutexLoad, &mutexAttr);
+    pthread_mutexattr_destroy(&mutexAttr);
+    if (mutexStatus==0) mutexStatus=pthread_mutex_lock(&shmSync->mutexLoad);
+    if (mutexStatus!=0) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not initialize the process-shared mutex in the shared memory: " << strerror(mutexStatus) << "\n" <<flush;
+        errOut << "SOLUTION: run STAR with --genomeLoad NoSharedMemory to avoid using shared memory\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_SHM, *P);
+    };
+    __atomic_store_n(&shmSync->syncReady, SHM_syncMagic, __ATOMIC_RELEASE);
+};
+
+static void genomeShmLoadFinish(char* shmStart) {//wake up the jobs waiting for the genome
+    pthread_mutex_unlock(& ((GenomeShmSync*) (shmStart+SHM_sync))->mutexLoad);
+};
+
+static void genomeShmWaitLoaded(Parameters* P, int shmID, char* shmStart) {
+    //wait until the job that allocated the shared memory has loaded the genome. The waiting job sleeps on the robust mutex held by the loading job,
+    //and wakes up as soon as it is released, or the loading job dies
+    GenomeShmSync *shmSync=(GenomeShmSync*) (shmStart+SHM_sync);
+    uint *shmNG=(uint*) (shmStart+SHM_sizeG);
+    if (*shmNG!=0) return; //loading has been completed
+
+    P->inOut->logMain <<"Another job is still loading the genome, waiting for it to finish ...\n" <<flush;
+    time_t timeStart;
+    time(&timeStart);
+    string errLoader="";
+    while (__atomic_load_n(&shmSync->syncReady, __ATOMIC_ACQUIRE)!=SHM_syncMagic) {//the segment was just created, the header is not initialized yet
+        struct shmid_ds shmStat;
+        if (shmctl(shmID,IPC_STAT,&shmStat)!=0 || (kill(shmStat.shm_cpid,0)!=0 && errno==ESRCH)) {
+            errLoader="the job that allocated the shared memory terminated before loading the genome";
+            break;
+        };
+        usleep(10000);
+    };
+
+    if (errLoader=="") {
+        int mutexStatus=pthread_mutex_lock(&shmSync->mutexLoad);
+        if (mutexStatus==EOWNERDEAD) {//the loading job died holding the lock
+            pthread_mutex_consistent(&shmSync->mutexLoad);
+            errLoader="the job that was loading the genome terminated before loading was completed";
+        } else if (mutexStatus!=0) {
+            errLoader="error from pthread_mutex_lock(): " + string(strerror(mutexStatus));
+        } else if (*shmNG==0) {//the lock was recovered by another waiting job
+            errLoader="the job that was loading the genome terminated before loading was completed";
+        };
+        if (mutexStatus==0 || mutexStatus==EOWNERDEAD) pthread_mutex_unlock(&shmSync->mutexLoad);
+    };
+
+    if (errLoader!="") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: the genome in shared memory is not usable: " << errLoader << "\n" <<flush;
+        errOut << "SOLUTION: remove the shared memory chunk with ipcrm, or by running STAR with --genomeLoad Remove, and restart STAR" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_SHM, *P);
+    };
+    time_t timeEnd;
+    time(&timeEnd);
+    P->inOut->logMain <<"The other job finished loading the genome, waited " << difftime(timeEnd,timeStart) << " seconds\n" <<flush;
+};
+
+static uint genomeHugePageLog2(Parameters* P) {//log2 of the requested huge page size, 0 if huge pages are not used
+    if (P->genomeHugePages=="2MB") return 21;
+    if (P->genomeHugePages=="1GB") return 30;
+    return 0;
+};
+
+static char* genomeArrayAllocate(Parameters* P, uint nBytes, const string &arrayName) {
+    //allocate a genome array with huge pages; if they are not available, fall back to standard pages with transparent huge pages
+    uint hugeLog2=genomeHugePageLog2(P);
+    uint hugeBytes=1LLU<<hugeLog2;
+    char *a=(char*) mmap(NULL, (nBytes+hugeBytes-1)/hugeBytes*hugeBytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB|(hugeLog2<<MAP_HUGE_SHIFT), -1, 0);
+    if (a!=MAP_FAILED) {
+        P->inOut->logMain << "Allocated " << arrayName << " array: " << nBytes << " bytes, page size " << P->genomeHugePages <<"\n"<<flush;
+        return a;
+    };
+    P->inOut->logMain << "WARNING: could not allocate " << arrayName << " array with " << P->genomeHugePages << " huge pages, error from mmap(): " << strerror(errno) \
+                      << ". Check the number of reserved huge pages in /proc/sys/vm/nr_hugepages. Falling back to standard pages\n"<<flush;
+
+    a=(char*) mmap(NULL, nBytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (a==MAP_FAILED) throw std::bad_alloc();
+    if (madvise(a, nBytes, MADV_HUGEPAGE)==0) {
+        P->inOut->logMain << "Allocated " << arrayName << " array: " << nBytes << " bytes, page size " << sysconf(_SC_PAGESIZE) << " bytes, transparent huge pages requested\n"<<flush;
+    } else {
+        P->inOut->logMain << "Allocated " << arrayName << " array: " << nBytes << " bytes, page size " << sysconf(_SC_PAGESIZE) << " bytes\n"<<flush;
+    };
+    return a;
+};
+
+struct GenomeNumaCopy {//copy of the genome arrays to be created on one NUMA node
+    vector <char*> src, dst;
+    vector <uint> nBytes;
+    const vector <int> *cpus;
+    bool ok;
+};
+
+static void* genomeNumaCopyThread(void *arg) {//bind to the node, allocate and copy; pages are placed on the node by the first touch
+    GenomeNumaCopy *c=(GenomeNumaCopy*) arg;
+    c->ok=numaBindThread(*c->cpus);
+    for (uint ii=0; ii<c->src.size(); ii++) {
+        char *a=(char*) mmap(NULL, c->nBytes[ii], PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (a==MAP_FAILED) {
+            c->ok=false;
+            c->dst.push_back(NULL);
+            continue;
+        };
+        memcpy(a, c->src[ii], c->nBytes[ii]);
+        c->dst.push_back(a);
+    };
+    return NULL;
+};
+
+void Genome::numaReplicate() {//one copy of G, SA, SAi, SAlcp, Gpacked per NUMA node, the loaded genome is the copy on node 0
+    uint L=200;
+    vector <char*> src;
+    vector <uint> nBytes;
+    src.push_back(G1); nBytes.push_back(P->nGenome+L+L);
+    src.push_back(SA.charArray); nBytes.push_back(SA.lengthByte);
+    src.push_back(SAi.charArray); nBytes.push_back(SAi.lengthByte);
+    uint iSAlcp=src.size();
+    if (SAlcp!=NULL) {
+        src.push_back((char*) SAlcp); nBytes.push_back(P->nSA);
+    };
+    uint iGpacked=src.size();
+    if (Gpacked!=NULL) {
+        src.push_back((char*) Gpacked); nBytes.push_back(genomePackedBlocks(P->nGenome)*GENOME_PACKED_BLOCK_WORDS*sizeof(uint64));
+    };
+
+    vector <GenomeNumaCopy> copies(numaNodeN);
+    vector <pthread_t> threads(numaNodeN);
+    for (uint in=1; in<numaNodeN; in++) {
+        copies[in].src=src;
+        copies[in].nBytes=nBytes;
+        copies[in].cpus=&numaNodeCPUs[in];
+        copies[in].ok=true;
+        if (pthread_create(&threads[in], NULL, genomeNumaCopyThread, (void*) &copies[in])!=0) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: could not create the thread to copy the genome to NUMA node " << numaNodeID[in] <<"\n";
+            errOut << "SOLUTION: run STAR with --genomeNUMA None\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+        };
+    };
+
+    numaG.assign(1,G);
+    numaSA.assign(1,SA.charArray);
+    numaSAi.assign(1,SAi.charArray);
+    numaSAlcp.assign(1,(char*) SAlcp);
+    numaGpacked.assign(1,(char*) Gpacked);
+    for (uint in=1; in<numaNodeN; in++) {
+        pthread_join(threads[in], NULL);
+        for (uint ii=0; ii<copies[in].dst.size(); ii++) {
+            if (copies[in].dst[ii]==NULL) {
+                ostringstream errOut;
+                errOut <<"EXITING: fatal error trying to allocate the copy of the genome on NUMA node " << numaNodeID[in] << ", error from mmap(): " << strerror(errno) <<"\n";
+                errOut <<"Possible cause: not enough RAM for one genome copy per node. SOLUTION: run STAR with --genomeNUMA Interleave or --genomeNUMA None\n" <<flush;
+                exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_MemoryAllocation, *P);
+            };
+        };
+        if (!copies[in].ok) P->inOut->logMain << "WARNING: could not bind the thread to the CPUs of NUMA node " << numaNodeID[in] << ", the genome copy may not be local to the node\n";
+        numaG.push_back(copies[in].dst[0]+L);
+        numaSA.push_back(copies[in].dst[1]);
+        numaSAi.push_back(copies[in].dst[2]);
+        numaSAlcp.push_back(SAlcp!=NULL ? copies[in].dst[iSAlcp] : NULL);
+        numaGpacked.push_back(Gpacked!=NULL ? copies[in].dst[iGpacked] : NULL);
+        P->inOut->logMain << "Copied the genome arrays to NUMA node " << numaNodeID[in] <<"\n";
+    };
+    P->inOut->logMain << flush;
+};
+
+void Genome::numaReplicaAssign(uint iNode, Genome &genomeOut) const {
+    if (iNode>=numaG.size()) return; //no copy for this node
+    genomeOut.G=numaG[iNode];
+    genomeOut.SA.pointArray(numaSA[iNode]);
+    genomeOut.SAi.pointArray(numaSAi[iNode]);
+    genomeOut.SAlcp=(uint8*) numaSAlcp[iNode];
+    genomeOut.Gpacked=(uint64*) numaGpacked[iNode];
+};
+
+#define GENOME_LOAD_CHUNK_BYTES (1LLU<<26) //files are loaded in chunks of this size, in parallel
+
+struct GenomeFileLoad {//one genome file to be loaded into an array
+    string fileName;
+    uint fileStart; //start of the array in the file
+    char *A; //array
+    uint N; //bytes to load
+    uint bytesRead;
+    double timeDone; //time when the last chunk was loaded
+    GenomeFileLoad (const string &fileNameIn, uint fileStartIn, char *Ain, uint Nin) : fileName(fileNameIn), fileStart(fileStartIn), A(Ain), N(Nin), bytesRead(0), timeDone(0) {};
+};
+
+static void genomeFilesLoad(Parameters* P, vector <GenomeFileLoad> &files) {
+    //load all files concurrently: the files are split into chunks which are read with pread() by runThreadN threads
+    vector <int> fileFD(files.size());
+    vector <uint> chunkFile, chunkStart;
+    for (uint ii=0; ii<files.size(); ii++) {
+        fileFD[ii]=open(files[ii].fileName.c_str(),O_RDONLY);
+        if (fileFD[ii]<0) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: could not open genome file "<< files[ii].fileName <<" : "<< strerror(errno) <<"\n";
+            errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n" <<flush;     
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+        for (uint c1=0; c1<files[ii].N; c1+=GENOME_LOAD_CHUNK_BYTES) {
+            chunkFile.push_back(ii);
+            chunkStart.push_back(c1);
+        };
+    };
+
+    vector <uint> chunkBytes(chunkFile.size(),0);
+    double timeStart=omp_get_wtime();
+    #pragma omp parallel for num_threads(P->runThreadN) schedule(dynamic,1)
+    for (int ic=0; ic<(int) chunkFile.size(); ic++) {
+        GenomeFileLoad &f1=files[chunkFile[ic]];
+        uint cStart=chunkStart[ic];
+        uint cBytes=min(GENOME_LOAD_CHUNK_BYTES, f1.N-cStart);
+        uint nRead=0;
+        while (nRead<cBytes) {
+            ssize_t n1=pread(fileFD[chunkFile[ic]], f1.A+cStart+nRead, cBytes-nRead, f1.fileStart+cStart+nRead);
+            if (n1<0 && errno==EINTR) continue;
+            if (n1<=0) break; //end of file or error: the number of loaded bytes of each file is checked by the caller
+            nRead+=n1;
+        };
+        chunkBytes[ic]=nRead;
+        double time1=omp_get_wtime();
+        #pragma omp critical
+        if (time1>f1.timeDone) f1.timeDone=time1;
+    };
+
+    for (uint ic=0; ic<chunkFile.size(); ic++) files[chunkFile[ic]].bytesRead+=chunkBytes[ic];
+    for (uint ii=0; ii<files.size(); ii++) {
+        close(fileFD[ii]);
+        double dt=max(files[ii].timeDone-timeStart,1e-6);
+        P->inOut->logMain << "Loaded " << files[ii].fileName << " : " << files[ii].bytesRead << " bytes in " << dt << " s, " << files[ii].bytesRead/dt/1e6 << " MB/s\n";
+    };
+    P->inOut->logMain << flush;
+};
+
+void Genome::genomeJobAttach(Parameters* Pjob) {//the arrays loaded by the alignment server are used by the job, the genome information is loaded into the job parameters
+    P=Pjob;
+    arraysLoaded=true;
+    genomeLoad();
+};
+
 void Genome::genomeLoad(){//allocate and load Genome
-    shmID=0;
+    if (!arraysLoaded) shmID=0;
     bool shmLoad=false;   
     key_t shmKey=ftok(P->genomeDir.c_str(),SHM_projectID);;    
     char *shmStart=NULL;
@@ -41,18 +361,35 @@ void Genome::genomeLoad(){//allocate and load Genome
 
     uint L=200,K=6;    
     
+    if (!arraysLoaded) numaNodeN=0;
+    if (!arraysLoaded && P->genomeNUMA!="None") {//NUMA placement of the genome
+        numaNodeN=numaNodesDetect(numaNodeID, numaNodeCPUs);
+        if (numaNodeN<2) {
+            P->inOut->logMain << "WARNING: --genomeNUMA " << P->genomeNUMA << " is not used: found " << numaNodeN << " NUMA node(s) with CPUs\n"<<flush;
+            numaNodeN=0;
+        } else {
+            P->inOut->logMain << "--genomeNUMA " << P->genomeNUMA << ": found " << numaNodeN << " NUMA nodes with CPUs\n"<<flush;
+            if (P->genomeNUMA=="Replicate" && !numaBindThread(numaNodeCPUs[0])) {//the loaded genome is the copy on the first node
+                P->inOut->logMain << "WARNING: could not bind the main thread to the CPUs of NUMA node " << numaNodeID[0] <<"\n"<<flush;
+            };
+        };
+    };
+
     time_t rawtime;
     time ( &rawtime );
     
     
     vector <uint> versionGenomeMin=P->versionGenome;
     P->versionGenome[0]=0;
+    P->genomeSAlayout="Packed"; //the default layout is not recorded in genomeParameters.txt
     
-    ifstream parFile((P->genomeDir+("/genomeParameters.txt")).c_str());
-    if (parFile.good()) {
+    GenomeIndexFile &gIndex=P->genomeIndex;
+    gIndex.open(P); //the genome files are the sections of the single-file index, if it is present
+    string parText;
+    if (gIndex.textRead("genomeParameters.txt", parText)) {
         P->inOut->logMain << "Reading genome generation parameters:\n";
+        istringstream parFile(parText);
         P->scanAllLines(parFile,3,-1);
-        parFile.close();
     } else {
         ostringstream errOut;
         errOut << "EXITING because of FATAL ERROR: could not open genome file "<< P->genomeDir+("/genomeParameters.txt") << endl;
@@ -80,39 +417,83 @@ void Genome::genomeLoad(){//allocate and load Genome
     P->inOut->logMain << "Started loading the genome: " << asctime (localtime ( &rawtime ))<<"\n"<<flush;    
   
     
-    ifstream GenomeIn((P->genomeDir+"/Genome").c_str(), ios::binary); 
-    if (!GenomeIn.good()) {
+    ifstream GenomeIn, SAin, SAiIn, SAlcpIn;
+    if (!gIndex.present) {//separate genome files
+        GenomeIn.open((P->genomeDir+"/Genome").c_str(), ios::binary); 
+        if (!GenomeIn.good()) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: could not open genome file "<< P->genomeDir<<"/Genome" <<"\n" << endl;
+            errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n" <<flush;     
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+    
+        SAin.open((P->genomeDir + "/SA").c_str(), ios::binary);
+        if (!SAin.good()) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: could not open genome file "<< P->genomeDir<<"/SA" <<"\n" << endl;
+            errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n" <<flush;     
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+    
+        SAiIn.open((P->genomeDir+"/SAindex").c_str(),ios::binary);
+        if (!SAiIn.good()) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: could not open genome file "<< P->genomeDir<<"/SAindex" <<"\n" << endl;
+            errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n" <<flush;     
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+    };
+
+    if (P->genomeSAlcp!="None" && P->genomeSAlcp!="Byte") {
         ostringstream errOut;
-        errOut << "EXITING because of FATAL ERROR: could not open genome file "<< P->genomeDir<<"/Genome" <<"\n" << endl;
-        errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n" <<flush;     
-        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        errOut << "EXITING because of FATAL ERROR: unrecognized value of genomeSAlcp=" << P->genomeSAlcp <<"\n";
+        errOut << "SOLUTION: use None or Byte for --genomeSAlcp, or re-generate the genome\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_PARAMETER, *P);
     };
-    
-    ifstream SAin((P->genomeDir + "/SA").c_str(), ios::binary);
-    if (!SAin.good()) {
+    if (P->genomeSAlcp=="Byte") {
+        if (!gIndex.present) SAlcpIn.open((P->genomeDir+"/SAlcp").c_str(),ios::binary);
+        if (gIndex.present ? gIndex.find("SAlcp")==NULL : !SAlcpIn.good()) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: could not open genome file "<< P->genomeDir<<"/SAlcp" <<"\n" << endl;
+            errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n";
+            errOut << "          If the genome was generated without --genomeSAlcp Byte, re-run mapping with --genomeSAlcp None\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+    };
+
+    if (P->genomePacked!="None" && P->genomePacked!="2bit") {
         ostringstream errOut;
-        errOut << "EXITING because of FATAL ERROR: could not open genome file "<< P->genomeDir<<"/SA" <<"\n" << endl;
-        errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n" <<flush;     
-        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        errOut << "EXITING because of FATAL ERROR: unrecognized value of genomePacked=" << P->genomePacked <<"\n";
+        errOut << "SOLUTION: use None or 2bit for --genomePacked, or re-generate the genome\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_PARAMETER, *P);
     };
-    
-    ifstream SAiIn((P->genomeDir+"/SAindex").c_str(),ios::binary);
-    if (!SAiIn.good()) {
+    if (P->genomePacked=="2bit" && (gIndex.present ? gIndex.find("GenomePacked")==NULL : access((P->genomeDir+"/GenomePacked").c_str(),R_OK)!=0)) {
         ostringstream errOut;
-        errOut << "EXITING because of FATAL ERROR: could not open genome file "<< P->genomeDir<<"/SAindex" <<"\n" << endl;
-        errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n" <<flush;     
+        errOut << "EXITING because of FATAL ERROR: could not open genome file "<< P->genomeDir<<"/GenomePacked" <<"\n" << endl;
+        errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n";
+        errOut << "          If the genome was generated without --genomePacked 2bit, re-run mapping with --genomePacked None\n" <<flush;
         exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
     };
 
     uint SAiInBytes=0;
-    SAiInBytes += fstreamReadBig(SAiIn,(char*) &P->genomeSAindexNbases, sizeof(P->genomeSAindexNbases));
-    P->genomeSAindexStart = new uint[P->genomeSAindexNbases+1];
-    SAiInBytes += fstreamReadBig(SAiIn,(char*) P->genomeSAindexStart, sizeof(P->genomeSAindexStart[0])*(P->genomeSAindexNbases+1));  
+    if (gIndex.present) {
+        gIndex.read("SAindex", SAiInBytes, (char*) &P->genomeSAindexNbases, sizeof(P->genomeSAindexNbases));
+        SAiInBytes += sizeof(P->genomeSAindexNbases);
+        P->genomeSAindexStart = new uint[P->genomeSAindexNbases+1];
+        gIndex.read("SAindex", SAiInBytes, (char*) P->genomeSAindexStart, sizeof(P->genomeSAindexStart[0])*(P->genomeSAindexNbases+1));
+        SAiInBytes += sizeof(P->genomeSAindexStart[0])*(P->genomeSAindexNbases+1);
+    } else {
+        SAiInBytes += fstreamReadBig(SAiIn,(char*) &P->genomeSAindexNbases, sizeof(P->genomeSAindexNbases));
+        P->genomeSAindexStart = new uint[P->genomeSAindexNbases+1];
+        SAiInBytes += fstreamReadBig(SAiIn,(char*) P->genomeSAindexStart, sizeof(P->genomeSAindexStart[0])*(P->genomeSAindexNbases+1));  
+    };
     P->nSAi=P->genomeSAindexStart[P->genomeSAindexNbases];
     P->inOut->logMain << "Read from SAindex: genomeSAindexNbases=" << P->genomeSAindexNbases <<"  nSAi="<< P->nSAi <<endl <<flush;
     
     //search for the genome in shared memory, if found, shmLoad is false, shmID is the ID
-    if (P->genomeLoad=="LoadAndKeep" || P->genomeLoad=="LoadAndRemove" || P->genomeLoad=="Remove" || P->genomeLoad=="LoadAndExit") {// find shared memory fragment
+    if (arraysLoaded) {
+        P->inOut->logMain <<"Using the genome loaded by the alignment server\n"<<flush;
+    } else if (P->genomeLoad=="LoadAndKeep" || P->genomeLoad=="LoadAndRemove" || P->genomeLoad=="Remove" || P->genomeLoad=="LoadAndExit") {// find shared memory fragment
         shmID=shmget(shmKey,0,0);
         shmLoad=(shmID==-1);
         if (shmLoad && errno !=ENOENT) {
@@ -124,7 +505,7 @@ void Genome::genomeLoad(){//allocate and load Genome
         if (!shmLoad) P->inOut->logMain <<"Found genome in shared memory\n"<<flush;
     };
     
-    if (P->genomeLoad=="Remove") {//kill the genome and exit
+    if (P->genomeLoad=="Remove" && !arraysLoaded) {//kill the genome and exit
         if (shmLoad) {//did not find genome in shared memory, nothing to kill
             ostringstream errOut;
             errOut << "EXITING: Did not find the genome in memory, did not remove any genomes from shared memory\n";
@@ -141,7 +522,11 @@ void Genome::genomeLoad(){//allocate and load Genome
             P->inOut->logMain <<"DONE: removed the genome from shared memory\n"<<flush;            
             exit(0);
         };
-    } else if (P->genomeLoad=="NoSharedMemory" || shmLoad) {//find the size of the genome and SAs from files - the genome is not in shared memory
+    } else if (gIndex.present && (P->genomeLoad=="NoSharedMemory" || P->genomeLoad=="Mmap" || shmLoad || arraysLoaded)) {//the sizes are recorded in the index header
+        P->nGenome=gIndex.section("Genome").length-2*GENOME_INDEX_GENOME_PAD;
+        P->nSAbyte=gIndex.section("SA").length;
+        P->inOut->logMain <<"Genome section size: "<<P->nGenome <<" bytes; SA section size: "<<P->nSAbyte <<" bytes\n"<<flush;
+    } else if (P->genomeLoad=="NoSharedMemory" || P->genomeLoad=="Mmap" || shmLoad || arraysLoaded) {//find the size of the genome and SAs from files - the genome is not in shared memory
      
         GenomeIn.seekg (0, ios::end);
         P->nGenome=(uint) GenomeIn.tellg();
@@ -169,18 +554,7 @@ void Genome::genomeLoad(){//allocate and load Genome
         shmNG= (uint*) (shmStart+SHM_sizeG);
         shmNSA= (uint*) (shmStart+SHM_sizeSA);       
    
-        uint iwait=0;
-        while (*shmNG==0) {
-            iwait++;
-            P->inOut->logMain <<"Another job is still loading the genome, sleeping for 1 min\n" <<flush;
-            sleep(60);                    
-            if (iwait==100) {
-                ostringstream errOut;
-                errOut << "EXITING because of FATAL ERROR: waited too long for the other job to finish loading the genome" << strerror(errno) << "\n" <<flush;
-                errOut << "SOLUTION: remove the shared memory chunk with ipcrm, or by running STAR with --genomeLoad Remove, and restart STAR" <<flush;     
-                exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GenomeLoadingWaitedTooLong, *P);                
-            };
-        };
+        genomeShmWaitLoaded(P, shmID, shmStart);
 
         P->nGenome=*shmNG;
         P->nSAbyte=*shmNSA;
@@ -193,8 +567,9 @@ void Genome::genomeLoad(){//allocate and load Genome
     if (P->GstrandBit<32) P->GstrandBit=32; //TODO: use simple access function for SA
     
     P->GstrandMask = ~(1LLU<<P->GstrandBit);
-    P->nSA=(P->nSAbyte*8)/(P->GstrandBit+1);
-    SA.defineBits(P->GstrandBit+1,P->nSA);  
+    uint SAwordLength=genomeSAwordLength(P); //--genomeSAlayout is defined by genomeParameters.txt
+    P->nSA=(P->nSAbyte*8)/SAwordLength;
+    SA.defineBits(SAwordLength,P->nSA);  
     
     P->SAiMarkNbit=P->GstrandBit+1;
     P->SAiMarkAbsentBit=P->GstrandBit+2;
@@ -208,16 +583,48 @@ void Genome::genomeLoad(){//allocate and load Genome
 
     
     P->inOut->logMain << "nGenome=" << P->nGenome << ";  nSAbyte=" << P->nSAbyte <<endl<< flush;       
-    P->inOut->logMain <<"GstrandBit="<<int(P->GstrandBit)<<"   SA number of indices="<<P->nSA<<endl<<flush;      
+    P->inOut->logMain <<"GstrandBit="<<int(P->GstrandBit)<<"   SA number of indices="<<P->nSA<<"   SA bits per index="<<SAwordLength<<endl<<flush;      
+
+    uint GpackedBytes=genomePackedBlocks(P->nGenome)*GENOME_PACKED_BLOCK_WORDS*sizeof(uint64);
+    if (gIndex.present) {//check the sizes of the other sections
+        if (gIndex.section("SAindex").length < SAiInBytes+SAi.lengthByte-1) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: the size of the section SAindex of the genome index file "<< gIndex.fileName <<" = " << gIndex.section("SAindex").length <<" is smaller than expected = " << SAiInBytes+SAi.lengthByte-1 <<"\n";
+            errOut << "SOLUTION: re-generate the genome\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+        if (P->genomeSAlcp=="Byte" && gIndex.section("SAlcp").length!=P->nSA) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: the size of the section SAlcp of the genome index file "<< gIndex.fileName <<" = " << gIndex.section("SAlcp").length <<" is not equal to the SA length = " << P->nSA <<"\n";
+            errOut << "SOLUTION: re-generate the genome with --genomeSAlcp Byte\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+        if (P->genomePacked=="2bit" && gIndex.section("GenomePacked").length!=GpackedBytes) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: the size of the section GenomePacked of the genome index file "<< gIndex.fileName <<" = " << gIndex.section("GenomePacked").length <<" is not equal to the expected = " << GpackedBytes <<"\n";
+            errOut << "SOLUTION: re-generate the genome with --genomePacked 2bit\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+    };
     
     
     /////////////////////////////////////// allocate arrays
-    if (P->genomeLoad=="NoSharedMemory") {// simply allocate memory, do not use shared memory
+    if (arraysLoaded) {
+        //the arrays and their padding are not changed
+    } else if (P->genomeLoad=="NoSharedMemory") {// simply allocate memory, do not use shared memory
         try {
-            G1=new char[P->nGenome+L+L];        
-            SA.allocateArray();
+            if (genomeHugePageLog2(P)==0) {
+                G1=new char[P->nGenome+L+L];        
+                SA.allocateArray();
+                SAi.allocateArray();
+            } else {
+                G1=genomeArrayAllocate(P, P->nGenome+L+L, "Genome");
+                SA.pointArray(genomeArrayAllocate(P, SA.lengthByte, "SA"));
+                SAi.pointArray(genomeArrayAllocate(P, SAi.lengthByte, "SAindex"));
+            };
             if (P->annotScoreScale>0) sigG=new char[P->nGenome];
-            SAi.allocateArray();
+            SAlcp = (P->genomeSAlcp=="Byte" ? new uint8[P->nSA] : NULL);
+            Gpacked = (P->genomePacked=="2bit" ? new uint64[GpackedBytes/sizeof(uint64)] : NULL);
             P->inOut->logMain <<"Shared memory is not used for genomes. Allocated a private copy of the genome.\n"<<flush;
         } 
         catch (exception & exc) {
@@ -227,13 +634,85 @@ void Genome::genomeLoad(){//allocate and load Genome
             errOut <<"Possible cause 2: not enough virtual memory allowed with ulimit. SOLUTION: run ulimit -v " <<  P->nGenome+L+L+SA.lengthByte+SAi.lengthByte+2000000000<<endl <<flush;
             exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_MemoryAllocation, *P);            
         };
+    } else if (P->genomeLoad=="Mmap" && gIndex.present) {//map the index file, the arrays point into its sections
+        uint fileBytes;
+        if (genomeHugePageLog2(P)>0) P->inOut->logMain << "WARNING: --genomeHugePages " << P->genomeHugePages << " is not used with --genomeLoad Mmap, the page size of the file system cache is used\n"<<flush;
+        char *indexStart=genomeFileMmap(P, gIndex.fileName, fileBytes, 0, 0, false);
+        G1=indexStart+gIndex.section("Genome").start+GENOME_INDEX_GENOME_PAD-L; //the padding is stored in the section
+        SA.pointArray(indexStart+gIndex.section("SA").start);
+        SAi.pointArray(indexStart+gIndex.section("SAindex").start+SAiInBytes);
+        SAlcp = (P->genomeSAlcp=="Byte" ? (uint8*) indexStart+gIndex.section("SAlcp").start : NULL);
+        Gpacked = (P->genomePacked=="2bit" ? (uint64*) (indexStart+gIndex.section("GenomePacked").start) : NULL);
+        if (P->annotScoreScale>0) sigG=new char[P->nGenome];
+        P->inOut->logMain <<"Shared memory is not used for genomes. Mapped the genome index file into memory.\n"<<flush;
+    } else if (P->genomeLoad=="Mmap") {//map the files, the arrays point into the file system cache
+        uint fileBytes;
+        if (genomeHugePageLog2(P)>0) P->inOut->logMain << "WARNING: --genomeHugePages " << P->genomeHugePages << " is not used with --genomeLoad Mmap, the page size of the file system cache is used\n"<<flush;
+        G1=genomeFileMmap(P, P->genomeDir+"/Genome", fileBytes, L, L, true) - L;
+        SA.pointArray(genomeFileMmap(P, P->genomeDir+"/SA", fileBytes, 0, sizeof(uint), false));
+        char *SAiFile=genomeFileMmap(P, P->genomeDir+"/SAindex", fileBytes, 0, sizeof(uint), false);
+        if (fileBytes < SAiInBytes+SAi.lengthByte-1) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: the size of the genome file "<< P->genomeDir<<"/SAindex" <<" = " << fileBytes <<" is smaller than expected = " << SAiInBytes+SAi.lengthByte-1 <<"\n";
+            errOut << "SOLUTION: re-generate the genome\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+        SAi.pointArray(SAiFile+SAiInBytes); //skip the header already read from the stream
+        if (P->genomeSAlcp=="Byte") {
+            SAlcp = (uint8*) genomeFileMmap(P, P->genomeDir+"/SAlcp", fileBytes, 0, 0, false);
+            if (fileBytes!=P->nSA) {
+                ostringstream errOut;
+                errOut << "EXITING because of FATAL ERROR: the size of the genome file "<< P->genomeDir<<"/SAlcp" <<" = " << fileBytes <<" is not equal to the SA length = " << P->nSA <<"\n";
+                errOut << "SOLUTION: re-generate the genome with --genomeSAlcp Byte\n" <<flush;
+                exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+            };
+        } else {
+            SAlcp = NULL;
+        };
+        if (P->genomePacked=="2bit") {
+            Gpacked = (uint64*) genomeFileMmap(P, P->genomeDir+"/GenomePacked", fileBytes, 0, 0, false);
+            if (fileBytes!=GpackedBytes) {
+                ostringstream errOut;
+                errOut << "EXITING because of FATAL ERROR: the size of the genome file "<< P->genomeDir<<"/GenomePacked" <<" = " << fileBytes <<" is not equal to the expected = " << GpackedBytes <<"\n";
+                errOut << "SOLUTION: re-generate the genome with --genomePacked 2bit\n" <<flush;
+                exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+            };
+        } else {
+            Gpacked = NULL;
+        };
+        if (P->annotScoreScale>0) sigG=new char[P->nGenome];
+        P->inOut->logMain <<"Shared memory is not used for genomes. Mapped the genome files into memory.\n"<<flush;
     } else {//using shared memeory
         
         if (shmLoad) {//genome was not in shared memory: allocate shm
             shmSize=SA.lengthByte + P->nGenome+L+L+SHM_startG+8;
             shmSize+= SAi.lengthByte;                
             if (P->annotScoreScale>0) shmSize+=P->nGenome;
-            shmID = shmget(shmKey, shmSize, IPC_CREAT | SHM_NORESERVE | 0666); //        shmID = shmget(shmKey, shmSize, IPC_CREAT | SHM_NORESERVE | SHM_HUGETLB | 0666);
+            if (P->genomeSAlcp=="Byte") shmSize+=P->nSA;
+            if (P->genomePacked=="2bit") shmSize+=GpackedBytes+64;
+            uint hugeLog2=genomeHugePageLog2(P);
+            if (hugeLog2>0) {//the segment size has to be a multiple of the huge page size
+                uint hugeBytes=1LLU<<hugeLog2;
+                shmID = shmget(shmKey, (shmSize+hugeBytes-1)/hugeBytes*hugeBytes, IPC_CREAT | IPC_EXCL | SHM_HUGETLB | (hugeLog2<<SHM_HUGE_SHIFT) | 0666); //no SHM_NORESERVE: the huge pages have to be reserved now, not fail on access
+                if (shmID >= 0) {
+                    P->inOut->logMain << "Allocated shared memory for the genome: " << shmSize << " bytes, page size " << P->genomeHugePages <<"\n"<<flush;
+                } else if (errno!=EEXIST) {
+                    P->inOut->logMain << "WARNING: could not allocate shared memory with " << P->genomeHugePages << " huge pages, error from shmget(): " << strerror(errno) \
+                                      << ". Check the number of reserved huge pages in /proc/sys/vm/nr_hugepages, and the group in /proc/sys/vm/hugetlb_shm_group. Falling back to standard pages\n"<<flush;
+                };
+            } else {
+                shmID = -1;
+                errno = 0;
+            };
+            if (shmID < 0 && errno!=EEXIST) {
+                shmID = shmget(shmKey, shmSize, IPC_CREAT | IPC_EXCL | SHM_NORESERVE | 0666);
+                if (shmID >= 0) P->inOut->logMain << "Allocated shared memory for the genome: " << shmSize << " bytes, page size " << sysconf(_SC_PAGESIZE) << " bytes\n"<<flush;
+            };
+            if (shmID < 0 && errno==EEXIST) {//another job allocated the shared memory after it was searched for above: use its genome
+                shmID = shmget(shmKey, 0, 0);
+                shmLoad = false;
+                P->inOut->logMain << "Another job has just allocated the genome in shared memory, will use it\n"<<flush;
+            };
             if (shmID < 0) {
                 ostringstream errOut;
                 errOut <<"EXITING: fatal error from shmget() trying to allocate shared memory piece: error type" << strerror(errno) <<"\n";
@@ -245,8 +724,19 @@ void Genome::genomeLoad(){//allocate and load Genome
 
             };
             shmStart = (char*) shmat(shmID, NULL, 0);
+            if (shmStart==((void *) -1)) {
+                ostringstream errOut;
+                errOut << "EXITING because of FATAL ERROR: problems with shared memory: error from shmat() while trying to get address of the shared memory piece:" << strerror(errno) << "\n" <<flush;
+                errOut << "SOLUTION: check shared memory settigns as explained in STAR manual, OR run STAR with --genomeLoad NoSharedMemory to avoid using shared memory\n" <<flush;     
+                exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_SHM, *P);
+            };          
             shmNG= (uint*) (shmStart+SHM_sizeG);
             shmNSA= (uint*) (shmStart+SHM_sizeSA);                          
+            if (shmLoad) {
+                genomeShmLoadStart(P, shmStart);
+            } else {
+                genomeShmWaitLoaded(P, shmID, shmStart);
+            };
         };
         
         G1=shmStart+SHM_startG;
@@ -260,44 +750,114 @@ void Genome::genomeLoad(){//allocate and load Genome
             sigG = shmNext;
             shmNext += P->nGenome;
         };        
+
+        if (P->genomeSAlcp=="Byte") {
+            SAlcp = (uint8*) shmNext;
+            shmNext += P->nSA;
+        } else {
+            SAlcp = NULL;
+        };
+
+        if (P->genomePacked=="2bit") {//aligned to the cache line
+            shmNext = shmStart + (shmNext-shmStart+63)/64*64;
+            Gpacked = (uint64*) shmNext;
+            shmNext += GpackedBytes;
+        } else {
+            Gpacked = NULL;
+        };
     };
 
     G=G1+L;
 
-    if (P->genomeLoad=="NoSharedMemory" || shmLoad) {//load genome and SAs from files
-        //load genome
-        P->inOut->logMain <<"Genome file size: "<<P->nGenome <<" bytes; state: good=" <<GenomeIn.good()\
-                <<" eof="<<GenomeIn.eof()<<" fail="<<GenomeIn.fail()<<" bad="<<GenomeIn.bad()<<"\n"<<flush;        
-        P->inOut->logMain <<"Loading Genome ... " << flush;        
-        uint genomeReadBytesN=fstreamReadBig(GenomeIn,G,P->nGenome);    
-        P->inOut->logMain <<"done! state: good=" <<GenomeIn.good()\
-                <<" eof="<<GenomeIn.eof()<<" fail="<<GenomeIn.fail()<<" bad="<<GenomeIn.bad()<<"; loaded "<<genomeReadBytesN<<" bytes\n" << flush;            
+    if (numaNodeN>0 && P->genomeNUMA=="Interleave" && !arraysLoaded) {//the policy has to be set before the pages are touched by loading
+        bool interleaveOK=true;
+        if (P->genomeLoad=="NoSharedMemory") {
+            interleaveOK = numaInterleave(G1, P->nGenome+L+L, numaNodeID) && numaInterleave(SA.charArray, SA.lengthByte, numaNodeID) \
+                        && numaInterleave(SAi.charArray, SAi.lengthByte, numaNodeID) && (SAlcp==NULL || numaInterleave((char*) SAlcp, P->nSA, numaNodeID)) \
+                        && (Gpacked==NULL || numaInterleave((char*) Gpacked, GpackedBytes, numaNodeID));
+        } else if (shmLoad) {
+            interleaveOK = numaInterleave(shmStart, shmSize, numaNodeID);
+        } else {
+            P->inOut->logMain << "WARNING: --genomeNUMA Interleave is not used: the genome pages were already placed by another process or the file system cache\n"<<flush;
+        };
+        if (interleaveOK) {
+            P->inOut->logMain << "Genome arrays are interleaved over " << numaNodeN << " NUMA nodes\n"<<flush;
+        } else {
+            P->inOut->logMain << "WARNING: could not interleave the genome arrays over NUMA nodes, error from mbind(): " << strerror(errno) <<"\n"<<flush;
+        };
+    };
+
+    if ((P->genomeLoad=="NoSharedMemory" || shmLoad) && !arraysLoaded) {//load genome and SAs from files
+        //load all files concurrently
+        vector <GenomeFileLoad> loadFiles;
+        if (gIndex.present) {//sections of the index file
+            loadFiles.push_back(GenomeFileLoad(gIndex.fileName, gIndex.section("Genome").start+GENOME_INDEX_GENOME_PAD, G, P->nGenome));
+            loadFiles.push_back(GenomeFileLoad(gIndex.fileName, gIndex.section("SA").start, SA.charArray, SA.lengthByte));
+            loadFiles.push_back(GenomeFileLoad(gIndex.fileName, gIndex.section("SAindex").start+SAiInBytes, SAi.charArray, SAi.lengthByte));
+            if (SAlcp!=NULL) loadFiles.push_back(GenomeFileLoad(gIndex.fileName, gIndex.section("SAlcp").start, (char*) SAlcp, P->nSA));
+            if (Gpacked!=NULL) loadFiles.push_back(GenomeFileLoad(gIndex.fileName, gIndex.section("GenomePacked").start, (char*) Gpacked, GpackedBytes));
+        } else {
+            loadFiles.push_back(GenomeFileLoad(P->genomeDir+"/Genome", 0, G, P->nGenome));
+            loadFiles.push_back(GenomeFileLoad(P->genomeDir+"/SA", 0, SA.charArray, SA.lengthByte));
+            loadFiles.push_back(GenomeFileLoad(P->genomeDir+"/SAindex", SAiInBytes, SAi.charArray, SAi.lengthByte)); //skip the header already read from the stream
+            if (SAlcp!=NULL) loadFiles.push_back(GenomeFileLoad(P->genomeDir+"/SAlcp", 0, (char*) SAlcp, P->nSA));
+            if (Gpacked!=NULL) loadFiles.push_back(GenomeFileLoad(P->genomeDir+"/GenomePacked", 0, (char*) Gpacked, GpackedBytes));
+        };
+        uint iSAlcp=3, iGpacked=(SAlcp!=NULL ? 4 : 3);
         GenomeIn.close();
+        SAin.close();
+        SAlcpIn.close();
+
+        P->inOut->logMain <<"Genome file size: "<<P->nGenome <<" bytes; SA file size: "<<P->nSAbyte <<" bytes\n";
+        P->inOut->logMain <<"Loading Genome, SA, SAindex"<< (SAlcp!=NULL ? ", SAlcp" : "") << (Gpacked!=NULL ? ", GenomePacked" : "") <<" with "<< P->runThreadN <<" threads ...\n" << flush;
+        genomeFilesLoad(P, loadFiles);
+        SAiInBytes += loadFiles[2].bytesRead;
+        P->inOut->logMain <<"done: loaded "<<loadFiles[0].bytesRead<<" bytes of Genome, "<<loadFiles[1].bytesRead<<" bytes of SA, "<<SAiInBytes<<" bytes of SAindex\n" << flush;
         
         for (uint ii=0;ii<L;ii++) {// attach a tail with the largest symbol
             G1[ii]=K-1;
             G[P->nGenome+ii]=K-1;        
         };    
-      
-        //load SAs
-        P->inOut->logMain <<"SA file size: "<<SA.lengthByte <<" bytes; state: good=" <<SAin.good()\
-                <<" eof="<<SAin.eof()<<" fail="<<SAin.fail()<<" bad="<<SAin.bad()<<"\n"<<flush;        
-        P->inOut->logMain <<"Loading SA ... " << flush;               
-        genomeReadBytesN=fstreamReadBig(SAin,SA.charArray, SA.lengthByte);
-        P->inOut->logMain <<"done! state: good=" <<SAin.good()\
-                <<" eof="<<SAin.eof()<<" fail="<<SAin.fail()<<" bad="<<SAin.bad()<<"; loaded "<<genomeReadBytesN<<" bytes\n" << flush;            
-        SAin.close();
-        
-        P->inOut->logMain <<"Loading SAindex ... " << flush;             
-        SAiInBytes +=fstreamReadBig(SAiIn,SAi.charArray, SAi.lengthByte);
-        P->inOut->logMain <<"done: "<<SAiInBytes<<" bytes\n" << flush;       
+
+        if (loadFiles[0].bytesRead!=P->nGenome) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: the size of the genome file "<< P->genomeDir<<"/Genome" <<" = " << loadFiles[0].bytesRead <<" is not equal to the genome length = " << P->nGenome <<"\n";
+            errOut << "SOLUTION: the genome files may be truncated or corrupted, re-generate the genome\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+        if (loadFiles[1].bytesRead!=SA.lengthByte) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: the size of the genome file "<< P->genomeDir<<"/SA" <<" = " << loadFiles[1].bytesRead <<" is not equal to the expected = " << SA.lengthByte <<"\n";
+            errOut << "SOLUTION: the genome files may be truncated or corrupted, re-generate the genome\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+        if (SAlcp!=NULL && loadFiles[iSAlcp].bytesRead!=P->nSA) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: the size of the genome file "<< P->genomeDir<<"/SAlcp" <<" = " << loadFiles[iSAlcp].bytesRead <<" is not equal to the SA length = " << P->nSA <<"\n";
+            errOut << "SOLUTION: re-generate the genome with --genomeSAlcp Byte\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+        if (Gpacked!=NULL && loadFiles[iGpacked].bytesRead!=GpackedBytes) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: the size of the genome file "<< P->genomeDir<<"/GenomePacked" <<" = " << loadFiles[iGpacked].bytesRead <<" is not equal to the expected = " << GpackedBytes <<"\n";
+            errOut << "SOLUTION: re-generate the genome with --genomePacked 2bit\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+        };
+    };
+    
+    if (P->genomeLoad=="Mmap" && !arraysLoaded && !gIndex.present) {//the padding is outside of the mapped files
+        for (uint ii=0;ii<L;ii++) {// attach a tail with the largest symbol
+            G1[ii]=K-1;
+            G[P->nGenome+ii]=K-1;        
+        };    
     };
     
     SAiIn.close();            
 
     if (shmLoad && (P->genomeLoad=="LoadAndKeep" || P->genomeLoad=="LoadAndRemove" || P->genomeLoad=="LoadAndExit") ) {//record sizes. This marks the end of genome loading
-        *shmNG=P->nGenome;
         *shmNSA=P->nSAbyte;
+        *shmNG=P->nGenome;
+        genomeShmLoadFinish(shmStart);
     };
     
     time ( &rawtime );
@@ -325,6 +885,11 @@ void Genome::genomeLoad(){//allocate and load Genome
         exit(0);
     };
     
+    if (numaNodeN>0 && !arraysLoaded) {
+        if (P->genomeNUMA=="Replicate") numaReplicate();
+        numaBindThreadAll(); //the main thread is bound again as a mapping thread
+    };
+
     //find chr starts from files
     P->chrInfoLoad();
 
@@ -335,14 +900,14 @@ void Genome::genomeLoad(){//allocate and load Genome
         P->sjdbN=0;
         P->sjGstart=P->chrStart[P->nChrReal]+1; //not sure why I need that
     } else {//there are sjdb chromosomes
-        ifstream sjdbInfo((P->genomeDir+"/sjdbInfo.txt").c_str());
-        if (sjdbInfo.fail()) {
+        string sjdbText;
+        if (!gIndex.textRead("sjdbInfo.txt", sjdbText)) {
             ostringstream errOut;                            
             errOut << "EXITING because of FATAL error, could not open file " << (P->genomeDir+"/sjdbInfo.txt") <<"\n";
             errOut << "SOLUTION: check that the path to genome files, specified in --genomDir is correct and the files are present, and have user read permsissions\n" <<flush;     
             exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
         };
-    
+        istringstream sjdbInfo(sjdbText);
         
         sjdbInfo >> P->sjdbN >> P->sjdbOverhang;
         P->sjdbLength=P->sjdbOverhang*2+1;
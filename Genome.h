@@ -9,14 +9,24 @@ class Genome {
         char *G, *sigG;
         PackedArray SA;
         PackedArray SAi;
+        uint8 *SAlcp; //LCP of each suffix with the previous one, NULL if not loaded
+        uint64 *Gpacked; //2-bit packed genome, NULL if not loaded
+        uint numaNodeN; //number of NUMA nodes used for the genome, 0 if NUMA placement is not used
+        vector <int> numaNodeID; //system IDs of the nodes
+        vector < vector <int> > numaNodeCPUs; //CPUs of each node
         void genomeLoad();
+        void genomeRelease(); //detach from the shared memory genome, remove it for --genomeLoad LoadAndRemove; called before the log files are closed
+        void genomeJobAttach(Parameters* Pjob); //use the loaded arrays for a job with its own parameters
+        void numaReplicaAssign(uint iNode, Genome &genomeOut) const; //point the arrays of genomeOut to the genome copy on the node
         
-        Genome (Parameters* Pin ) : P(Pin) {};
+        Genome (Parameters* Pin ) : P(Pin), arraysLoaded(false) {};
         Genome () {};
-        ~Genome();
     private:
         char *G1; //pointer -200 of G
         Parameters* P;
         int shmID;
+        bool arraysLoaded; //genomeLoad only re-reads the genome information, the arrays were loaded before
+        vector <char*> numaG, numaSA, numaSAi, numaSAlcp, numaGpacked; //genome copies on the NUMA nodes, [0] is the loaded genome
+        void numaReplicate();
 };
 #endif
@@ -0,0 +1,309 @@
+#include "GenomeIndexFile.h"
+#include "Parameters.h"
+#include "ErrorWarning.h"
+#include "TimeFunctions.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <omp.h>
+
+static_assert(sizeof(GenomeIndexHeader)<=GENOME_INDEX_ALIGN_PAGE, "GenomeIndexHeader does not fit into the first page of the index file");
+
+#define GENOME_INDEX_CHECKSUM_CHUNK (1LLU<<24) //the checksum is calculated for the chunks in parallel, then combined
+#define GENOME_INDEX_COPY_BYTES (1LLU<<26)
+
+static inline uint64 checksumMix(uint64 h, uint64 w) {
+    h^=w;
+    h*=0x9E3779B97F4A7C15LLU;
+    return h^(h>>32);
+};
+
+static uint64 checksumChunk(const char *A, uint64 N, uint64 seed) {//four independent lanes of 8-byte words
+    uint64 h[4]={seed, seed+1, seed+2, seed+3};
+    uint64 ii=0;
+    for (; ii+32<=N; ii+=32) {
+        uint64 w[4];
+        memcpy(w, A+ii, 32);
+        for (int ih=0; ih<4; ih++) h[ih]=checksumMix(h[ih],w[ih]);
+    };
+    for (; ii<N; ii+=8) {
+        uint64 w1=0;
+        memcpy(&w1, A+ii, min((uint64) 8, N-ii));
+        h[0]=checksumMix(h[0],w1);
+    };
+    return checksumMix(checksumMix(checksumMix(h[0],h[1]),h[2]),h[3]);
+};
+
+uint64 genomeIndexChecksum(const char *A, uint64 N, int threadN) {
+    uint64 chunkN=(N+GENOME_INDEX_CHECKSUM_CHUNK-1)/GENOME_INDEX_CHECKSUM_CHUNK;
+    vector <uint64> chunkSum(chunkN);
+    #pragma omp parallel for num_threads(threadN) schedule(dynamic,1)
+    for (int64 ic=0; ic<(int64) chunkN; ic++) {
+        uint64 c1=ic*GENOME_INDEX_CHECKSUM_CHUNK;
+        chunkSum[ic]=checksumChunk(A+c1, min(GENOME_INDEX_CHECKSUM_CHUNK, N-c1), ic);
+    };
+    uint64 h=N;
+    for (uint64 ic=0; ic<chunkN; ic++) h=checksumMix(h,chunkSum[ic]);
+    return checksumMix(h,chunkN);
+};
+
+static uint64 headerChecksum(const GenomeIndexHeader &header) {
+    GenomeIndexHeader header1=header;
+    header1.headerChecksum=0;
+    return genomeIndexChecksum((char*) &header1, sizeof(header1), 1);
+};
+
+void GenomeIndexFile::open(Parameters *Pin) {
+    P=Pin;
+    fileName=P->genomeDir+"/"+GENOME_INDEX_FILE_NAME;
+    int fileFD=::open(fileName.c_str(),O_RDONLY);
+    present = fileFD>=0;
+    if (!present) return;
+
+    struct stat fileStat;
+    fstat(fileFD,&fileStat);
+    ssize_t headerBytes=pread(fileFD,&header,sizeof(header),0);
+    close(fileFD);
+
+    ostringstream errHeader;
+    if (headerBytes!=(ssize_t) sizeof(header) || memcmp(header.magic,GENOME_INDEX_MAGIC,sizeof(header.magic))!=0) {
+        errHeader << "the file is not a STAR genome index file";
+    } else if (header.version!=GENOME_INDEX_VERSION) {
+        errHeader << "the format version of the file = " << header.version << " is not supported by this STAR release, which reads format version " << GENOME_INDEX_VERSION;
+    } else if (header.headerChecksum!=headerChecksum(header)) {
+        errHeader << "the checksum of the file header does not agree with its contents, the file is corrupted";
+    } else if (header.fileBytes!=(uint64) fileStat.st_size) {
+        errHeader << "the size of the file = " << fileStat.st_size << " is not equal to the size recorded in its header = " << header.fileBytes <<", the file is truncated or corrupted";
+    } else if (header.sectionN>GENOME_INDEX_SECTION_MAX) {
+        errHeader << "the number of sections = " << header.sectionN << " is larger than the maximum = " << GENOME_INDEX_SECTION_MAX;
+    } else {
+        uint64 sectionEnd=sizeof(header);
+        for (uint32 is=0; is<header.sectionN; is++) {//sections are ordered, aligned and do not overlap
+            GenomeIndexSection &s1=header.section[is];
+            if (memchr(s1.name, 0, GENOME_INDEX_NAME_MAX)==NULL || s1.start<sectionEnd || s1.start%GENOME_INDEX_ALIGN_PAGE!=0 \
+                    || s1.length+GENOME_INDEX_TAIL > header.fileBytes || s1.start > header.fileBytes-s1.length-GENOME_INDEX_TAIL) {
+                errHeader << "the section #" << is << " is not within the file or overlaps the previous section";
+                break;
+            };
+            sectionEnd=s1.start+s1.length;
+        };
+    };
+    if (errHeader.str()!="") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR in the genome index file " << fileName << " : " << errHeader.str() <<"\n";
+        errOut << "SOLUTION: re-generate the genome with --genomeIndexFile Add, OR remove the file " << fileName << " to use the separate genome files\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+    };
+    P->inOut->logMain << "Using the genome index file " << fileName << " : format version " << header.version << ", " << header.sectionN << " sections, " << header.fileBytes << " bytes\n" <<flush;
+};
+
+const GenomeIndexSection* GenomeIndexFile::find(const string &name) const {
+    if (!present) return NULL;
+    for (uint32 is=0; is<header.sectionN; is++) {
+        if (name==header.section[is].name) return header.section+is;
+    };
+    return NULL;
+};
+
+const GenomeIndexSection& GenomeIndexFile::section(const string &name) const {
+    const GenomeIndexSection *s1=find(name);
+    if (s1==NULL) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not find the section " << name << " in the genome index file " << fileName <<"\n";
+        errOut << "SOLUTION: re-generate the genome with --genomeIndexFile Add\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+    };
+    return *s1;
+};
+
+void GenomeIndexFile::read(const string &name, uint64 offset, char *A, uint64 N) const {
+    const GenomeIndexSection &s1=section(name);
+    uint64 nRead=0;
+    int fileFD=::open(fileName.c_str(),O_RDONLY);
+    while (fileFD>=0 && offset+N<=s1.length && nRead<N) {
+        ssize_t n1=pread(fileFD, A+nRead, N-nRead, s1.start+offset+nRead);
+        if (n1<0 && errno==EINTR) continue;
+        if (n1<=0) break;
+        nRead+=n1;
+    };
+    if (fileFD>=0) close(fileFD);
+    if (nRead!=N) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not read " << N << " bytes from the section " << name << " of the genome index file " << fileName <<"\n";
+        errOut << "SOLUTION: check the file with --runMode genomeVerify, re-generate the genome if it is corrupted\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+    };
+};
+
+bool GenomeIndexFile::textRead(const string &name, string &textOut) const {
+    if (present) {
+        const GenomeIndexSection *s1=find(name);
+        if (s1==NULL) return false;
+        textOut.resize(s1->length);
+        if (s1->length>0) read(name, 0, &textOut[0], s1->length);
+        return true;
+    };
+    ifstream fileIn((P->genomeDir+"/"+name).c_str());
+    if (fileIn.fail()) return false;
+    ostringstream textStream;
+    textStream << fileIn.rdbuf();
+    textOut=textStream.str();
+    return true;
+};
+
+static void genomeIndexWriteError(Parameters *P, const string &fileName) {
+    ostringstream errOut;
+    errOut << "EXITING because of FATAL ERROR: could not write the genome index file " << fileName << " : " << strerror(errno) <<"\n";
+    errOut << "SOLUTION: check that you have write permission for the genomeDir, and there is enough disk space\n" <<flush;
+    exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+};
+
+static void pwriteAll(Parameters *P, int fileFD, const string &fileName, const char *A, uint64 N, uint64 fileStart) {
+    uint64 nWritten=0;
+    while (nWritten<N) {
+        ssize_t n1=pwrite(fileFD, A+nWritten, N-nWritten, fileStart+nWritten);
+        if (n1<0 && errno==EINTR) continue;
+        if (n1<=0) genomeIndexWriteError(P, fileName);
+        nWritten+=n1;
+    };
+};
+
+void genomeIndexWrite(Parameters *P) {
+    time_t rawTime;
+    time(&rawTime);
+    P->inOut->logMain     << timeMonthDayTime(rawTime) <<" ... writing the genome index file\n" <<flush;
+    *P->inOut->logStdOut  << timeMonthDayTime(rawTime) <<" ... writing the genome index file\n" <<flush;
+
+    //genome files in the order of the sections; the optional files are only packed if they were generated
+    const char* fileNames[]={"genomeParameters.txt", "chrName.txt", "chrStart.txt", "chrLength.txt", "chrNameLength.txt", "sjdbInfo.txt", "sjdbList.out.tab", \
+                             "Genome", "SA", "SAindex", "SAlcp", "GenomePacked"};
+    const bool fileOptional[]={false, false, false, false, false, true, true, false, false, false, true, true};
+    const uint fileN=sizeof(fileNames)/sizeof(fileNames[0]);
+
+    string fileNameOut=P->genomeDir+"/"+GENOME_INDEX_FILE_NAME;
+    string fileNameTmp=fileNameOut+".tmp"; //renamed when complete, an incomplete index file is never used
+    int fileOutFD=open(fileNameTmp.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0666);
+    if (fileOutFD<0) genomeIndexWriteError(P, fileNameTmp);
+
+    GenomeIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GENOME_INDEX_MAGIC, sizeof(header.magic));
+    header.version=GENOME_INDEX_VERSION;
+
+    vector <char> copyBuffer(GENOME_INDEX_COPY_BYTES);
+    vector <string> filesPacked;
+    uint64 fileOutBytes=GENOME_INDEX_ALIGN_PAGE; //the header
+    for (uint ii=0; ii<fileN; ii++) {
+        string fileName1=P->genomeDir+"/"+fileNames[ii];
+        int fileInFD=open(fileName1.c_str(), O_RDONLY);
+        struct stat fileStat;
+        if (fileInFD<0 || fstat(fileInFD,&fileStat)!=0) {
+            if (fileOptional[ii]) continue;
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: could not open genome file "<< fileName1 <<" to write it into the genome index file : "<< strerror(errno) <<"\n";
+            errOut << "SOLUTION: re-generate the genome in an empty directory\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+        };
+
+        bool isGenome = string(fileNames[ii])=="Genome";
+        uint64 alignBytes = (fileNames[ii][0]>='A' && fileNames[ii][0]<='Z') ? GENOME_INDEX_ALIGN_ARRAY : GENOME_INDEX_ALIGN_PAGE; //the arrays start at huge page boundaries
+        GenomeIndexSection &s1=header.section[header.sectionN++];
+        strncpy(s1.name, fileNames[ii], GENOME_INDEX_NAME_MAX-1);
+        s1.start=(fileOutBytes+alignBytes-1)/alignBytes*alignBytes;
+        s1.length=(uint64) fileStat.st_size + (isGenome ? 2*GENOME_INDEX_GENOME_PAD : 0);
+
+        uint64 copyStart=s1.start;
+        if (isGenome) {//the padding of the genome array is stored with the genome
+            memset(copyBuffer.data(), GENOME_INDEX_GENOME_PAD_CHAR, GENOME_INDEX_GENOME_PAD);
+            pwriteAll(P, fileOutFD, fileNameTmp, copyBuffer.data(), GENOME_INDEX_GENOME_PAD, copyStart);
+            pwriteAll(P, fileOutFD, fileNameTmp, copyBuffer.data(), GENOME_INDEX_GENOME_PAD, s1.start+s1.length-GENOME_INDEX_GENOME_PAD);
+            copyStart+=GENOME_INDEX_GENOME_PAD;
+        };
+        uint64 nCopied=0;
+        while (nCopied<(uint64) fileStat.st_size) {
+            ssize_t n1=read(fileInFD, copyBuffer.data(), GENOME_INDEX_COPY_BYTES);
+            if (n1<0 && errno==EINTR) continue;
+            if (n1<=0) break;
+            pwriteAll(P, fileOutFD, fileNameTmp, copyBuffer.data(), n1, copyStart+nCopied);
+            nCopied+=n1;
+        };
+        close(fileInFD);
+        if (nCopied!=(uint64) fileStat.st_size) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL ERROR: could not read genome file "<< fileName1 <<" : read " << nCopied << " bytes out of " << fileStat.st_size <<"\n";
+            errOut << "SOLUTION: re-generate the genome in an empty directory\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+        };
+        fileOutBytes=s1.start+s1.length;
+        filesPacked.push_back(fileName1);
+    };
+    header.fileBytes=fileOutBytes+GENOME_INDEX_TAIL;
+    if (ftruncate(fileOutFD, header.fileBytes)!=0) genomeIndexWriteError(P, fileNameTmp);
+
+    //checksums of the sections as they are written in the file
+    char *fileMap=(char*) mmap(NULL, header.fileBytes, PROT_READ, MAP_SHARED, fileOutFD, 0);
+    if (fileMap==MAP_FAILED) genomeIndexWriteError(P, fileNameTmp);
+    for (uint32 is=0; is<header.sectionN; is++) {
+        GenomeIndexSection &s1=header.section[is];
+        s1.checksum=genomeIndexChecksum(fileMap+s1.start, s1.length, P->runThreadN);
+        P->inOut->logMain << "Genome index section " << s1.name << " : start=" << s1.start << " length=" << s1.length << " checksum=" << hex << s1.checksum << dec <<"\n";
+    };
+    munmap(fileMap, header.fileBytes);
+    header.headerChecksum=headerChecksum(header);
+    pwriteAll(P, fileOutFD, fileNameTmp, (char*) &header, sizeof(header), 0);
+    if (fsync(fileOutFD)!=0 || close(fileOutFD)!=0 || rename(fileNameTmp.c_str(), fileNameOut.c_str())!=0) genomeIndexWriteError(P, fileNameOut);
+
+    if (P->genomeIndexFile=="Only") {//the index file replaces the separate genome files
+        for (uint ii=0; ii<filesPacked.size(); ii++) remove(filesPacked[ii].c_str());
+    };
+    P->inOut->logMain << "Finished writing the genome index file " << fileNameOut << " : " << header.sectionN << " sections, " << header.fileBytes << " bytes\n" <<flush;
+};
+
+void genomeIndexVerify(Parameters *P) {
+    time_t rawTime;
+    time(&rawTime);
+    P->inOut->logMain     << timeMonthDayTime(rawTime) <<" ... verifying the genome index file\n" <<flush;
+    *P->inOut->logStdOut  << timeMonthDayTime(rawTime) <<" ... verifying the genome index file\n" <<flush;
+
+    GenomeIndexFile &gIndex=P->genomeIndex;
+    gIndex.open(P); //checks the header, the size of the file and the section table
+    if (!gIndex.present) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not open the genome index file " << gIndex.fileName << " : " << strerror(errno) <<"\n";
+        errOut << "SOLUTION: check --genomeDir, OR generate the genome with --genomeIndexFile Add\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+    };
+
+    int fileFD=open(gIndex.fileName.c_str(), O_RDONLY);
+    char *fileMap = fileFD<0 ? (char*) MAP_FAILED : (char*) mmap(NULL, gIndex.header.fileBytes, PROT_READ, MAP_PRIVATE, fileFD, 0);
+    if (fileMap==MAP_FAILED) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not map the genome index file " << gIndex.fileName << " into memory, error from mmap(): " << strerror(errno) <<"\n";
+        errOut << "SOLUTION: check that the virtual memory is not limited with ulimit -v\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_MemoryAllocation, *P);
+    };
+    close(fileFD);
+    madvise(fileMap, gIndex.header.fileBytes, MADV_SEQUENTIAL);
+
+    ostringstream errSections;
+    for (uint32 is=0; is<gIndex.header.sectionN; is++) {
+        const GenomeIndexSection &s1=gIndex.header.section[is];
+        uint64 checksum1=genomeIndexChecksum(fileMap+s1.start, s1.length, P->runThreadN);
+        P->inOut->logMain << "Genome index section " << s1.name << " : start=" << s1.start << " length=" << s1.length << " checksum=" << hex << checksum1 << dec \
+                          << (checksum1==s1.checksum ? " OK" : " MISMATCH") <<"\n" <<flush;
+        if (checksum1!=s1.checksum) errSections << " " << s1.name;
+    };
+    munmap(fileMap, gIndex.header.fileBytes);
+
+    if (errSections.str()!="") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: the checksums of the sections" << errSections.str() << " of the genome index file " << gIndex.fileName << " do not agree with their contents\n";
+        errOut << "SOLUTION: re-generate the genome with --genomeIndexFile Add\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_GENOME_FILES, *P);
+    };
+
+    time(&rawTime);
+    P->inOut->logMain     << timeMonthDayTime(rawTime) <<" ... the genome index file is valid: " << gIndex.header.sectionN << " sections, " << gIndex.header.fileBytes << " bytes\n" <<flush;
+    *P->inOut->logStdOut  << timeMonthDayTime(rawTime) <<" ... the genome index file is valid: " << gIndex.header.sectionN << " sections, " << gIndex.header.fileBytes << " bytes\n" <<flush;
+};
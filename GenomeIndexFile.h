@@ -0,0 +1,57 @@
+#ifndef DEF_GenomeIndexFile
+#define DEF_GenomeIndexFile
+
+#include "IncludeDefine.h"
+
+//single-file genome index: all genome files of the genomeDir are stored as sections of one file, which can be mapped into memory with one mmap
+//layout: header with the section table in the first page, then the sections; the genome arrays start at huge page boundaries, the text files at page boundaries
+#define GENOME_INDEX_FILE_NAME "GenomeIndex"
+#define GENOME_INDEX_MAGIC "STARGIDX"
+#define GENOME_INDEX_VERSION 1
+#define GENOME_INDEX_SECTION_MAX 32
+#define GENOME_INDEX_NAME_MAX 48
+#define GENOME_INDEX_ALIGN_PAGE (1LLU<<12)
+#define GENOME_INDEX_ALIGN_ARRAY (1LLU<<21)
+#define GENOME_INDEX_GENOME_PAD 200 //the Genome section contains the padding of the genome array: this number of bytes before and after the genome
+#define GENOME_INDEX_GENOME_PAD_CHAR 5 //value of the padding bytes, the largest genome symbol
+#define GENOME_INDEX_TAIL 16 //zero bytes after the last section, the packed arrays are read past their ends
+
+class Parameters;
+
+struct GenomeIndexSection {
+    char name[GENOME_INDEX_NAME_MAX]; //name of the genome file
+    uint64 start, length; //bytes from the start of the index file
+    uint64 checksum; //genomeIndexChecksum of the section
+};
+
+struct GenomeIndexHeader {
+    char magic[8];
+    uint32 version;
+    uint32 sectionN;
+    uint64 fileBytes;
+    uint64 headerChecksum; //of the header with headerChecksum=0
+    GenomeIndexSection section[GENOME_INDEX_SECTION_MAX];
+};
+
+class GenomeIndexFile {//reads the genome files: sections of the index file if it is present in genomeDir, otherwise separate files
+    public:
+        bool present; //the index file was found
+        string fileName;
+        GenomeIndexHeader header;
+
+        GenomeIndexFile() : present(false), P(NULL) {};
+        void open(Parameters *Pin); //find the index file in P->genomeDir and check its header
+        const GenomeIndexSection* find(const string &name) const; //NULL if there is no such section
+        const GenomeIndexSection& section(const string &name) const; //exits if there is no such section
+        bool textRead(const string &name, string &textOut) const; //text file of the genome; false if it does not exist
+        void read(const string &name, uint64 offset, char *A, uint64 N) const; //N bytes of the section from the offset
+
+    private:
+        Parameters *P;
+};
+
+uint64 genomeIndexChecksum(const char *A, uint64 N, int threadN); //64-bit checksum, computed in parallel over fixed chunks: independent of threadN
+void genomeIndexWrite(Parameters *P); //pack the generated genome files into the index file
+void genomeIndexVerify(Parameters *P); //check the header and the checksums of all sections, exits with error if they do not agree
+
+#endif
@@ -0,0 +1,27 @@
+#include "GenomePacked.h"
+
+uint64 genomePackedBlocks(uint nGenome) {//the last block is only read as the upper half of unaligned words
+    return (nGenome+2*GENOME_PACKED_PAD+63)/64+1;
+};
+
+void genomePackedFill(const char *G, uint nGenome, uint64 *Gp, int threadN) {
+    uint64 nBlocks=genomePackedBlocks(nGenome);
+    #pragma omp parallel for num_threads(threadN) schedule(static)
+    for (int64 ib=0; ib<(int64) nBlocks; ib++) {
+        uint64 lo=0, hi=0, mask=0;
+        for (uint64 ii=0; ii<64; ii++) {
+            int64 pos=ib*64+ii-GENOME_PACKED_PAD;
+            char g1 = (pos>=0 && pos<(int64) nGenome) ? G[pos] : 5; //outside of the genome: padding
+            if (g1>=0 && g1<4) {
+                lo |= (uint64) (g1&1)<<ii;
+                hi |= (uint64) ((g1>>1)&1)<<ii;
+            } else {
+                mask |= 1LLU<<ii;
+                lo |= (uint64) (g1!=4)<<ii;
+            };
+        };
+        Gp[ib*GENOME_PACKED_BLOCK_WORDS]=lo;
+        Gp[ib*GENOME_PACKED_BLOCK_WORDS+1]=hi;
+        Gp[ib*GENOME_PACKED_BLOCK_WORDS+2]=mask;
+    };
+};
@@ -0,0 +1,67 @@
+#ifndef DEF_GenomePacked
+#define DEF_GenomePacked
+
+#include "IncludeDefine.h"
+
+//2-bit packed genome: each block of 64 bases is stored in 3 words - low bits and high bits of the A,C,G,T codes, and the mask of the other bases (N, chromosome padding).
+//For the masked bases, the low bit distinguishes N (0, genome value 4) from the padding (1, genome value 5).
+//Bit i of a word is the base 64*block+i. The packed array covers the genome with GENOME_PACKED_PAD bases of padding on each side
+#define GENOME_PACKED_PAD 256
+#define GENOME_PACKED_BLOCK_WORDS 3
+
+uint64 genomePackedBlocks(uint nGenome); //number of 64-base blocks
+void genomePackedFill(const char *G, uint nGenome, uint64 *Gp, int threadN); //pack the genome G[0...nGenome)
+
+static inline uint64 genomePackedWord(const uint64 *Gp, uint64 q, uint plane) {//64 bases starting from the packed position q
+    uint64 b=q>>6, o=q&63;
+    uint64 w0=Gp[b*GENOME_PACKED_BLOCK_WORDS+plane];
+    if (o==0) return w0;
+    return (w0>>o) | (Gp[(b+1)*GENOME_PACKED_BLOCK_WORDS+plane]<<(64-o));
+};
+
+static inline uint32 bitReverse32(uint32 x) {
+    x = ((x>>1) & 0x55555555) | ((x & 0x55555555)<<1);
+    x = ((x>>2) & 0x33333333) | ((x & 0x33333333)<<2);
+    x = ((x>>4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F)<<4);
+    return __builtin_bswap32(x);
+};
+
+static inline void genomePackedLoad32(const uint64 *Gp, int64 pos, bool rev, uint32 &lo, uint32 &hi, uint32 &mask) {
+    //32 bases starting from the genome position pos, forward or backward (rev): bit i is the base pos+i or pos-i
+    uint64 q = (uint64) (pos + GENOME_PACKED_PAD - (rev ? 31 : 0));
+    lo  =(uint32) genomePackedWord(Gp,q,0);
+    hi  =(uint32) genomePackedWord(Gp,q,1);
+    mask=(uint32) genomePackedWord(Gp,q,2);
+    if (rev) {
+        lo=bitReverse32(lo);
+        hi=bitReverse32(hi);
+        mask=bitReverse32(mask);
+    };
+};
+
+static inline char genomePackedBase(const uint64 *Gp, int64 pos) {//genome value 0...5 at the position
+    uint64 q = (uint64) (pos + GENOME_PACKED_PAD);
+    const uint64 *w=Gp+(q>>6)*GENOME_PACKED_BLOCK_WORDS;
+    uint64 o=q&63;
+    char lo=(char) ((w[0]>>o)&1);
+    if ((w[2]>>o)&1) return 4+lo;
+    return lo | (char) (((w[1]>>o)&1)<<1);
+};
+
+static inline char genomePackedWindowBase(uint32 lo, uint32 hi, uint32 mask, uint b) {//genome value 0...5 of the base b of a 32-base window
+    char lo1=(char) ((lo>>b)&1);
+    if ((mask>>b)&1) return 4+lo1;
+    return lo1 | (char) (((hi>>b)&1)<<1);
+};
+
+static inline void readPlanesScalar(const char *s, bool rev, uint n, uint32 &lo, uint32 &hi, uint32 &bad) {//same bit planes for n<=32 read bases
+    lo=0; hi=0; bad=0;
+    for (uint ii=0; ii<n; ii++) {
+        uint32 b=(uint32) (unsigned char) (rev ? s[-(int64)ii] : s[ii]);
+        lo  |= (b&1)<<ii;
+        hi  |= ((b>>1)&1)<<ii;
+        bad |= (uint32) (b>3)<<ii;
+    };
+};
+
+#endif
@@ -5,6 +5,11 @@ InOutStreams::InOutStreams() {
     logStdOut=NULL;
     outSAM=NULL;
     outBAMfileUnsorted=NULL;
+    outBAMfileCoord=NULL;
+    for (int ii=0;ii<MAX_N_MATES;ii++) {
+        readIn[ii]=NULL;
+        readInBuf[ii]=NULL;
+    };
 };
 
 InOutStreams::~InOutStreams() {
@@ -43,6 +48,11 @@ InOutStreams::~InOutStreams() {
     outLocalChains.close();
     
     
+    for (int ii=0;ii<MAX_N_MATES;ii++) {//the read streams are deleted before their buffers
+        delete readIn[ii];
+        delete readInBuf[ii];
+    };
+
     for (int ii=0;ii<2;ii++) {
         if (outUnmappedReadsStream[ii].is_open()) {
             outUnmappedReadsStream[ii].flush();
@@ -11,7 +11,8 @@ class InOutStreams {
     BGZF *outBAMfileUnsorted, *outBAMfileCoord;
     
     ofstream outChimSAM, outChimJunction, logMain, logProgress, logFinal, outUnmappedReadsStream[MAX_N_MATES];
-    ifstream readIn[MAX_N_MATES];
+    istream *readIn[MAX_N_MATES];
+    streambuf *readInBuf[MAX_N_MATES]; //stream buffers of readIn created by STAR, NULL for the other streams
     
     //compilation-optional streams
     ofstream outLocalChains;
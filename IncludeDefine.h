@@ -81,22 +81,17 @@ typedef uint8_t uint8;
 
 #define BAM_ATTR_MaxSize 1000
 
-#if defined COMPILE_FOR_LONG_READS
-    #define MAX_N_EXONS 200
+#define MAX_N_EXONS 20 //default max number of exons per alignment, --limitAlignExonsN -1
+#define MAX_N_EXONS_LONG_READS 200 //same, with --alignLongReads 1
+#if defined COMPILE_FOR_LONG_READS //default of --alignLongReads -1
+    #define DEF_alignLongReads 1
 #else
-    #define MAX_N_EXONS 20
+    #define DEF_alignLongReads 0
 #endif     
 
 //input reads
 #define MAX_N_MATES 2
 #define DEF_readNameLengthMax 50000
-#define DEF_readSeqLengthMax 50000
-
-#if (DEF_readNameLengthMax > DEF_readSeqLengthMax)
-        #define DEF_readNameSeqLengthMax DEF_readNameLengthMax
-#else
-        #define DEF_readNameSeqLengthMax DEF_readSeqLengthMax
-#endif
 
 #define EXIT_CODE_BUG 101
 #define EXIT_CODE_PARAMETER 102
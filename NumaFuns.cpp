@@ -0,0 +1,80 @@
+#include "NumaFuns.h"
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+
+#define NUMA_MPOL_INTERLEAVE 3 //from linux/mempolicy.h
+#define NUMA_NODES_MAX 1024
+
+static bool cpuListParse(const string &cpuList, vector <int> &cpus) {//parse the list format of /sys: 0-3,8,10-11
+    istringstream listStream(cpuList);
+    string range1;
+    while (getline(listStream,range1,',')) {
+        if (range1.find_first_not_of(" \n")==string::npos) continue;
+        int c1=-1, c2=-1;
+        if (sscanf(range1.c_str(),"%d-%d",&c1,&c2)==1) c2=c1;
+        if (c1<0 || c2<c1) return false;
+        for (int c=c1; c<=c2; c++) cpus.push_back(c);
+    };
+    return true;
+};
+
+uint numaNodesDetect(vector <int> &nodeID, vector < vector <int> > &nodeCPUs) {
+    nodeID.clear();
+    nodeCPUs.clear();
+    DIR *dirp = opendir("/sys/devices/system/node/");
+    if (dirp == NULL) return 0;
+    struct dirent *dp = NULL;
+    while ((dp = readdir(dirp)) != NULL) {
+        int id1;
+        if (strncmp(dp->d_name,"node",4)!=0 || sscanf(dp->d_name+4,"%d",&id1)!=1) continue;
+        ifstream cpuListFile(("/sys/devices/system/node/"+string(dp->d_name)+"/cpulist").c_str());
+        string cpuList;
+        getline(cpuListFile,cpuList);
+        vector <int> cpus;
+        if (!cpuListParse(cpuList,cpus) || cpus.size()==0) continue; //memory-only nodes are not used
+        nodeID.push_back(id1);
+        nodeCPUs.push_back(cpus);
+    };
+    closedir(dirp);
+
+    for (uint ii=1; ii<nodeID.size(); ii++) {//sort by node ID
+        for (uint jj=ii; jj>0 && nodeID[jj]<nodeID[jj-1]; jj--) {
+            swap(nodeID[jj],nodeID[jj-1]);
+            swap(nodeCPUs[jj],nodeCPUs[jj-1]);
+        };
+    };
+    return nodeID.size();
+};
+
+bool numaBindThread(const vector <int> &cpus) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (uint ii=0; ii<cpus.size(); ii++) {
+        if (cpus[ii]<CPU_SETSIZE) CPU_SET(cpus[ii],&cpuSet);
+    };
+    return pthread_setaffinity_np(pthread_self(),sizeof(cpuSet),&cpuSet)==0;
+};
+
+bool numaBindThreadAll() {
+    vector <int> cpus;
+    long cpuN=sysconf(_SC_NPROCESSORS_CONF);
+    for (int ii=0; ii<cpuN; ii++) cpus.push_back(ii);
+    return numaBindThread(cpus);
+};
+
+bool numaInterleave(char *a, uint nBytes, const vector <int> &nodeID) {
+    unsigned long nodeMask[NUMA_NODES_MAX/(8*sizeof(unsigned long))];
+    memset(nodeMask,0,sizeof(nodeMask));
+    for (uint ii=0; ii<nodeID.size(); ii++) {
+        if (nodeID[ii]<NUMA_NODES_MAX) nodeMask[nodeID[ii]/(8*sizeof(unsigned long))] |= 1LU << (nodeID[ii]%(8*sizeof(unsigned long)));
+    };
+    //mbind needs page-aligned start, the partial first page is not interleaved
+    uint pageBytes=(uint) sysconf(_SC_PAGESIZE);
+    uint aStart=((uint) a + pageBytes-1)/pageBytes*pageBytes;
+    uint aEnd=(uint) a + nBytes;
+    if (aEnd<=aStart) return true;
+    return syscall(SYS_mbind, (void*) aStart, aEnd-aStart, NUMA_MPOL_INTERLEAVE, nodeMask, (unsigned long) NUMA_NODES_MAX, 0)==0;
+};
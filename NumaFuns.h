@@ -0,0 +1,11 @@
+#ifndef DEF_NumaFuns
+#define DEF_NumaFuns
+
+#include "IncludeDefine.h"
+
+uint numaNodesDetect(vector <int> &nodeID, vector < vector <int> > &nodeCPUs); //NUMA nodes with CPUs and their CPUs, from /sys; returns number of nodes
+bool numaBindThread(const vector <int> &cpus); //bind the calling thread to the CPUs
+bool numaBindThreadAll(); //allow the calling thread to run on all CPUs
+bool numaInterleave(char *a, uint nBytes, const vector <int> &nodeID); //interleave the pages of the array over the nodes; the pages should not be touched yet
+
+#endif
@@ -25,3 +25,68 @@ void PackedArray::pointArray(char* pointerCharIn) {
 void PackedArray::allocateArray() {
     charArray=new char[lengthByte];
 };
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+    #define PACKED_ARRAY_SIMD
+    #include <immintrin.h>
+#endif
+
+#ifdef PACKED_ARRAY_SIMD
+
+static bool cpuSupportsAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+};
+static const bool packedArrayAVX2=cpuSupportsAVX2(); //runtime dispatch, checked once
+
+__attribute__((target("avx2"))) static uint decodeRange40AVX2(const char* A, uint start, uint n, uint* out) {
+    //4 elements per step: 2 elements (10 bytes) in each 128-bit lane are spread into 8-byte words with a byte shuffle
+    const __m256i shuf=_mm256_setr_epi8(0,1,2,3,4,-1,-1,-1,5,6,7,8,9,-1,-1,-1, 0,1,2,3,4,-1,-1,-1,5,6,7,8,9,-1,-1,-1);
+    uint ii=0;
+    for (; ii+6<=n; ii+=4) {//the 16-byte loads do not read past the element start+ii+5
+        const char* p=A+(start+ii)*5;
+        __m256i v=_mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) p)), _mm_loadu_si128((const __m128i*) (p+10)), 1);
+        _mm256_storeu_si256((__m256i*) (out+ii), _mm256_shuffle_epi8(v,shuf));
+    };
+    return ii;
+};
+
+__attribute__((target("avx2"))) static uint decodeRangeAVX2(const char* A, uint wordLength, uint start, uint n, uint* out) {
+    //4 elements per step: 8-byte words are gathered at the byte offsets of the elements, shifted by the bit offsets and masked
+    const __m256i mask=_mm256_set1_epi64x((long long) ((~0LLU)>>(64-wordLength)));
+    const __m256i seven=_mm256_set1_epi64x(7);
+    const __m256i step=_mm256_set1_epi64x((long long) (4*wordLength));
+    __m256i b=_mm256_add_epi64(_mm256_set1_epi64x((long long) (start*wordLength)), _mm256_setr_epi64x(0, (long long) wordLength, (long long) (2*wordLength), (long long) (3*wordLength)));
+    uint ii=0;
+    for (; ii+4<=n; ii+=4) {
+        __m256i v=_mm256_i64gather_epi64((const long long*) A, _mm256_srli_epi64(b,3), 1);
+        v=_mm256_and_si256(_mm256_srlv_epi64(v, _mm256_and_si256(b,seven)), mask);
+        _mm256_storeu_si256((__m256i*) (out+ii), v);
+        b=_mm256_add_epi64(b,step);
+    };
+    return ii;
+};
+
+#endif
+
+void PackedArray::decodeRange(uint start, uint n, uint* out) const {
+    uint ii=0;
+    switch (wordLength) {
+        case 64:
+            memcpy(out, charArray+start*8, n*sizeof(uint));
+            return;
+        case 40:
+#ifdef PACKED_ARRAY_SIMD
+            if (packedArrayAVX2) ii=decodeRange40AVX2(charArray, start, n, out);
+#endif
+            for (; ii<n; ii++) out[ii]=get<40>(start+ii);
+            return;
+        default:
+#ifdef PACKED_ARRAY_SIMD
+            if (packedArrayAVX2 && wordLength<=57) ii=decodeRangeAVX2(charArray, wordLength, start, n, out); //the element and its bit offset fit into 8 bytes
+#endif
+            for (uint b=(start+ii)*wordLength; ii<n; ii++, b+=wordLength) {//the bit offset is advanced, no multiplication
+                out[ii] = ((*((uint*) (charArray+b/8)) >> (b%8)) << wordCompLength) >> wordCompLength;
+            };
+    };
+};
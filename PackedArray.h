@@ -3,14 +3,21 @@
 
 #include "IncludeDefine.h"
 
+#define PACKED_ARRAY_BITS_ANY 0 //get<> for an arbitrary wordLength
+
 class PackedArray {
     private:
-        uint bitRecMask, wordCompLength;    
+        uint bitRecMask, wordCompLength;
     public:
         uint wordLength, length, lengthByte;
         uint operator [] (uint ii);
+        template <uint wordBits> uint get (uint ii) const; //element ii for the wordLength=wordBits, or any wordLength for PACKED_ARRAY_BITS_ANY
+        void decodeRange (uint start, uint n, uint* out) const; //elements start...start+n-1 into out[0...n-1]
+        void prefetch (uint ii) {//start loading the element ii into the cache
+            __builtin_prefetch(charArray+ii*wordLength/8);
+        };
         char* charArray;
-        
+
     void defineBits (uint Nbits, uint lengthIn);
     void writePacked(uint jj, uint x);
     void allocateArray();
@@ -18,7 +25,7 @@ class PackedArray {
 //     PackedArray(uint N);
 };
 
-inline uint PackedArray::operator [] (uint ii) {
+template <> inline uint PackedArray::get <PACKED_ARRAY_BITS_ANY> (uint ii) const {
    uint b=ii*wordLength;
    uint B=b/8;
    uint S=b%8;
@@ -28,4 +35,20 @@ inline uint PackedArray::operator [] (uint ii) {
    return a1;
 };
 
+template <> inline uint PackedArray::get <40> (uint ii) const {//5-byte words: no shift, one mask
+   return *((uint*) (charArray+ii*5)) & 0xFFFFFFFFFFLLU;
+};
+
+template <> inline uint PackedArray::get <64> (uint ii) const {//8-byte words: plain load
+   return ((uint*) charArray)[ii];
+};
+
+inline uint PackedArray::operator [] (uint ii) {//the byte-aligned word lengths are read with the specialized accessors
+   switch (wordLength) {
+       case 40: return get<40>(ii);
+       case 64: return get<64>(ii);
+       default: return get<PACKED_ARRAY_BITS_ANY>(ii);
+   };
+};
+
 #endif
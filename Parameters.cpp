@@ -3,8 +3,10 @@
 #include "ErrorWarning.h"
 #include "SequenceFuns.h"
 #include "OutSJ.h"
+#include "Transcript.h"
 #include "sysRemoveDir.h"
 #include "stringSubstituteAll.h"
+#include "ReadFilesStreambuf.h"
 #include SAMTOOLS_BGZF_H
 
 //for mkfifo
@@ -26,14 +28,23 @@ Parameters::Parameters() {//initalize parameters info
     //run
     parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "runMode", &runMode));
     parArray.push_back(new ParameterInfoScalar <int> (-1, -1, "runThreadN", &runThreadN));        
+    parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "serverSocket", &serverSocket));
 
     //genome
     parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomeDir", &genomeDir));
     parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomeLoad", &genomeLoad));        
+    parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomeMmapPopulate", &genomeMmapPopulate));
+    parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomeMmapAdvise", &genomeMmapAdvise));
+    parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomeHugePages", &genomeHugePages));
+    parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomeNUMA", &genomeNUMA));
     parArray.push_back(new ParameterInfoVector <string> (-1, -1, "genomeFastaFiles", &genomeFastaFiles));
     parArray.push_back(new ParameterInfoScalar <uint> (-1, -1, "genomeSAindexNbases", &genomeSAindexNbases));        
     parArray.push_back(new ParameterInfoScalar <uint> (-1, -1, "genomeChrBinNbits", &genomeChrBinNbits));        
     parArray.push_back(new ParameterInfoScalar <uint> (-1, -1, "genomeSAsparseD", &genomeSAsparseD));        
+    parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomeSAlcp", &genomeSAlcp));
+    parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomePacked", &genomePacked));
+    parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomeSAlayout", &genomeSAlayout));
+    parArray.push_back(new ParameterInfoScalar <string> (-1, -1, "genomeIndexFile", &genomeIndexFile));
 
     //read
     parArray.push_back(new ParameterInfoVector <string> (-1, -1, "readFilesIn", &readFilesIn));
@@ -46,6 +57,9 @@ Parameters::Parameters() {//initalize parameters info
     parArray.push_back(new ParameterInfoScalar <uint>   (-1, -1, "limitOutSAMoneReadBytes", &limitOutSAMoneReadBytes));
     parArray.push_back(new ParameterInfoScalar <uint>   (-1, -1, "limitOutSJcollapsed", &limitOutSJcollapsed));
     parArray.push_back(new ParameterInfoScalar <uint>   (-1, -1, "limitOutSJoneRead", &limitOutSJoneRead));
+    parArray.push_back(new ParameterInfoScalar <uint>   (-1, -1, "limitBAMsortRAM", &limitBAMsortRAM));
+    parArray.push_back(new ParameterInfoScalar <uint>   (-1, -1, "limitReadSeqLength", &limitReadSeqLength));
+    parArray.push_back(new ParameterInfoScalar <int>    (-1, -1, "limitAlignExonsN", &limitAlignExonsN));
 
     //output
     parArray.push_back(new ParameterInfoScalar <string>     (-1, 2, "outFileNamePrefix", &outFileNamePrefix));
@@ -68,6 +82,8 @@ Parameters::Parameters() {//initalize parameters info
     parArray.push_back(new ParameterInfoVector <string>     (-1, -1, "outSAMheaderHD", &outSAMheaderHD));
     parArray.push_back(new ParameterInfoVector <string>     (-1, -1, "outSAMheaderPG", &outSAMheaderPG));
     parArray.push_back(new ParameterInfoScalar <string>     (-1, -1, "outSAMheaderCommentFile", &outSAMheaderCommentFile));
+    parArray.push_back(new ParameterInfoScalar <int>        (-1, -1, "outBAMcompression", &outBAMcompression));
+    parArray.push_back(new ParameterInfoScalar <uint>       (-1, -1, "outBAMsortingBinsN", &outBAMsortingBinsN));
 
 
    //output SJ filtering
@@ -143,6 +159,8 @@ Parameters::Parameters() {//initalize parameters info
     parArray.push_back(new ParameterInfoScalar <uint>       (-1, -1, "alignWindowsPerReadNmax", &alignWindowsPerReadNmax));  
     parArray.push_back(new ParameterInfoScalar <uint>       (-1, -1, "alignTranscriptsPerWindowNmax", &alignTranscriptsPerWindowNmax));  
     parArray.push_back(new ParameterInfoScalar <string>     (-1, -1, "alignEndsType", &alignEndsType));  
+    parArray.push_back(new ParameterInfoScalar <uint>       (-1, -1, "alignDuplicatesCacheN", &alignDuplicatesCacheN));
+    parArray.push_back(new ParameterInfoScalar <int>        (-1, -1, "alignLongReads", &alignLongReads));
 
     //chimeric
     parArray.push_back(new ParameterInfoScalar <uint>      (-1, -1, "chimSegmentMin", &chimSegmentMin));    
@@ -341,10 +359,18 @@ void Parameters::inputParameters (int argInN, char* argIn[]) {//input parameters
     
     if (runMode=="alignReads") inOut->logProgress.open((outFileNamePrefix + "Log.progress.out").c_str());
 
+    outBAMbool=false; //BAM outputs are off unless requested with --outSAMtype
+    outBAMunsorted=false;
+    outBAMcoord=false;
     if (outStd=="Log") {
         if (runMode=="alignReads" && outSAMmode != "None") {//open SAM file and write header
             if (outSAMtype.at(0)=="BAM") {
-                outBAMcompression=0;//TODO make this input parameter
+                if (outBAMcompression<0 || outBAMcompression>9) {
+                    ostringstream errOut;
+                    errOut <<"EXITING because of fatal input ERROR: outBAMcompression=" << outBAMcompression << " is out of range\n";
+                    errOut <<"SOLUTION: re-run STAR with --outBAMcompression between 0 (no compression) and 9 (maximum compression)\n"<<flush;
+                    exitWithError(errOut.str(), std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+                };
                 outBAMbool=true;
                 outBAMunsorted=false;
                 outBAMcoord=false;
@@ -365,6 +391,12 @@ void Parameters::inputParameters (int argInN, char* argIn[]) {//input parameters
                     inOut->outBAMfileUnsorted = bgzf_open((outFileNamePrefix + "Aligned.out.bam").c_str(),("w"+to_string((long long) outBAMcompression)).c_str());
                 };
                 if (outBAMcoord) {
+                    if (outBAMsortingBinsN==0) {
+                        ostringstream errOut;
+                        errOut <<"EXITING because of fatal input ERROR: outBAMsortingBinsN=0\n";
+                        errOut <<"SOLUTION: re-run STAR with --outBAMsortingBinsN >0\n"<<flush;
+                        exitWithError(errOut.str(), std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+                    };
                     inOut->outBAMfileCoord = bgzf_open((outFileNamePrefix + "Aligned.out.SortCoordinate.bam").c_str(),("w"+to_string((long long) outBAMcompression)).c_str());
                 };                
             } else if (outSAMtype.at(0)=="SAM") {
@@ -419,25 +451,53 @@ void Parameters::inputParameters (int argInN, char* argIn[]) {//input parameters
     } else if (limitGenomeGenerateRAM>1000000000000) {//
         inOut->logMain <<"WARNING: specified limitGenomeGenerateRAM="<<limitGenomeGenerateRAM<<" bytes appears to be too large, if you do not have enough memory the code will crash!\n"<<flush;
     };
+
+    if (limitReadSeqLength==0) {
+        ostringstream errOut;
+        errOut <<"EXITING because of FATAL PARAMETER ERROR: limitReadSeqLength=0\n";
+        errOut <<"SOLUTION: please specify a >0 value for limitReadSeqLength, not smaller than the longest read (sum of the mates lengths for paired-end reads)\n";
+        exitWithError(errOut.str(), std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+    };
+
+    if (alignLongReads==-1) alignLongReads=DEF_alignLongReads;
+    if (alignLongReads!=0 && alignLongReads!=1) {
+        ostringstream errOut;
+        errOut <<"EXITING because of FATAL PARAMETER ERROR: alignLongReads="<<alignLongReads<<"\n";
+        errOut <<"SOLUTION: please specify 0 (short reads), 1 (long reads) or -1 (the default of the executable) for alignLongReads\n";
+        exitWithError(errOut.str(), std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+    };
+    uint nExonsDefault=(alignLongReads==1 ? MAX_N_EXONS_LONG_READS : MAX_N_EXONS);
+
+    if (limitAlignExonsN==-1) {//the exon arrays of all alignments are allocated with this size
+        Transcript::nExonsMax=nExonsDefault;
+    } else if (limitAlignExonsN>0) {
+        Transcript::nExonsMax=(uint) limitAlignExonsN;
+    } else {
+        ostringstream errOut;
+        errOut <<"EXITING because of FATAL PARAMETER ERROR: limitAlignExonsN="<<limitAlignExonsN<<"\n";
+        errOut <<"SOLUTION: please specify a >0 value for limitAlignExonsN, or -1 for the default: "<<nExonsDefault<<"\n";
+        exitWithError(errOut.str(), std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+    };
             
     readNmates=readFilesIn.size(); //for now the number of mates is defined by the number of input files
     if (runMode=="alignReads" && genomeLoad!="Remove" && genomeLoad!="LoadAndExit") {//open reads files to check if they are present
         
         string readFilesCommandString("");
-        if (readFilesCommand.at(0)=="-") {
-            if (readFilesIn.at(0).find(',')<readFilesIn.at(0).size()) readFilesCommandString="cat";//concatenate multiple files
-        } else {
+        if (readFilesCommand.at(0)!="-") {
             for (uint ii=0; ii<readFilesCommand.size(); ii++) readFilesCommandString+=readFilesCommand.at(ii)+"   ";
         };
         
-        if (readFilesCommandString=="") {//read from file
+        if (readFilesCommandString=="") {//read from file: gzip/BGZF files are decompressed, comma-separated files are concatenated by ReadFilesStreambuf
             for (uint ii=0;ii<readNmates;ii++) {//open readIn files
-                inOut->readIn[ii].open(readFilesIn.at(ii).c_str()); //try to open the Sequences file right away, exit if failed
-                if (inOut->readIn[ii].fail()) {
-                    ostringstream errOut;
-                    errOut <<"EXITING because of fatal input ERROR: could not open readFilesIn=" << readFilesIn.at(ii) <<"\n";
-                    exitWithError(errOut.str(), std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);                
-                };  
+                vector <string> readFilesNames;
+                string readFilesInString(readFilesIn.at(ii));
+                for (size_t pos1=0, pos2=0; pos1<=readFilesInString.size(); pos1=pos2+1) {
+                    pos2=readFilesInString.find(',',pos1);
+                    if (pos2==string::npos) pos2=readFilesInString.size();
+                    readFilesNames.push_back(readFilesInString.substr(pos1,pos2-pos1));
+                };
+                inOut->readInBuf[ii] = new ReadFilesStreambuf (readFilesNames, this); //exits if the files cannot be opened
+                inOut->readIn[ii] = new istream (inOut->readInBuf[ii]);
             };    
         } else {//create fifo files, execute pre-processing command
             
@@ -451,7 +511,7 @@ void Parameters::inputParameters (int argInN, char* argIn[]) {//input parameters
                 stringSubstituteAll(readFilesInString,",","\" \"");
                 string systemString=readFilesCommandString + "   \"" + readFilesInString + "\" > "  + readFilesInTmp.at(ii) + " & ";
                 system(systemString.c_str());                
-                inOut->readIn[ii].open(readFilesInTmp.at(ii).c_str());
+                inOut->readIn[ii] = new ifstream (readFilesInTmp.at(ii).c_str());
             };
         };
         
@@ -504,7 +564,7 @@ void Parameters::inputParameters (int argInN, char* argIn[]) {//input parameters
     #define BUFFER_InSizeFraction 0.5
     chunkInSizeBytesArray=(uint) int((limitIObufferSize-limitOutSJcollapsed*Junction::dataSize)*BUFFER_InSizeFraction)/2;
     chunkOutSAMsizeBytes= (uint) int((1.0/BUFFER_InSizeFraction-1.0)*chunkInSizeBytesArray*2.0);
-    chunkInSizeBytes=chunkInSizeBytesArray-2*(DEF_readSeqLengthMax+1)-2*DEF_readNameLengthMax;//to prevent overflow
+    chunkInSizeBytes=chunkInSizeBytesArray-2*(limitReadSeqLength+1)-2*DEF_readNameLengthMax;//to prevent overflow
     
     //basic trimming
     if (clip5pNbases.size()==1 && readNmates==2) clip5pNbases.push_back(clip5pNbases[0]);    
@@ -684,12 +744,57 @@ void Parameters::inputParameters (int argInN, char* argIn[]) {//input parameters
 //     genomeNumToNT={'A','C','G','T','N'};
     strcpy(genomeNumToNT,"ACGTN");
     
-    if (genomeLoad!="LoadAndKeep" && genomeLoad!="LoadAndRemove" && genomeLoad!="Remove" && genomeLoad!="LoadAndExit" && genomeLoad!="NoSharedMemory") {// find shared memory fragment
+    if (genomeLoad!="LoadAndKeep" && genomeLoad!="LoadAndRemove" && genomeLoad!="Remove" && genomeLoad!="LoadAndExit" && genomeLoad!="NoSharedMemory" && genomeLoad!="Mmap") {// find shared memory fragment
         ostringstream errOut;
         errOut << "EXITING because of FATAL INPUT ERROR: --genomeLoad=" << genomeLoad << "\n" <<flush;
-        errOut << "SOLUTION: use one of the allowed values of --genomeLoad : NoSharedMemory,LoadAndKeep,LoadAndRemove,LoadAndExit,Remove.\n" <<flush;     
+        errOut << "SOLUTION: use one of the allowed values of --genomeLoad : NoSharedMemory,LoadAndKeep,LoadAndRemove,LoadAndExit,Remove,Mmap.\n" <<flush;     
         exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
     };
+    
+    if (genomeMmapPopulate!="No" && genomeMmapPopulate!="Yes") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT ERROR: --genomeMmapPopulate=" << genomeMmapPopulate << "\n" <<flush;
+        errOut << "SOLUTION: use one of the allowed values of --genomeMmapPopulate : No,Yes.\n" <<flush;     
+        exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+    };
+    if (genomeMmapAdvise!="None" && genomeMmapAdvise!="Random" && genomeMmapAdvise!="Sequential" && genomeMmapAdvise!="WillNeed") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT ERROR: --genomeMmapAdvise=" << genomeMmapAdvise << "\n" <<flush;
+        errOut << "SOLUTION: use one of the allowed values of --genomeMmapAdvise : None,Random,Sequential,WillNeed.\n" <<flush;     
+        exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+    };
+    if (genomeHugePages!="None" && genomeHugePages!="2MB" && genomeHugePages!="1GB") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT ERROR: --genomeHugePages=" << genomeHugePages << "\n" <<flush;
+        errOut << "SOLUTION: use one of the allowed values of --genomeHugePages : None,2MB,1GB.\n" <<flush;     
+        exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+    };
+    if (genomeNUMA!="None" && genomeNUMA!="Replicate" && genomeNUMA!="Interleave") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT ERROR: --genomeNUMA=" << genomeNUMA << "\n" <<flush;
+        errOut << "SOLUTION: use one of the allowed values of --genomeNUMA : None,Replicate,Interleave.\n" <<flush;     
+        exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+    };
+    if (genomeIndexFile!="None" && genomeIndexFile!="Add" && genomeIndexFile!="Only") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT ERROR: --genomeIndexFile=" << genomeIndexFile << "\n" <<flush;
+        errOut << "SOLUTION: use one of the allowed values of --genomeIndexFile : None,Add,Only.\n" <<flush;     
+        exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+    };
+    if (runMode=="alignServer") {
+        if (serverSocket=="-") {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL INPUT ERROR: --runMode alignServer requires the path of the server socket\n" <<flush;
+            errOut << "SOLUTION: specify --serverSocket /path/to/socket\n" <<flush;     
+            exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+        };
+        if (genomeLoad=="Remove" || genomeLoad=="LoadAndExit") {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL INPUT ERROR: --genomeLoad " << genomeLoad << " cannot be used with --runMode alignServer\n" <<flush;
+            errOut << "SOLUTION: use --genomeLoad NoSharedMemory, Mmap, LoadAndKeep or LoadAndRemove\n" <<flush;     
+            exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_PARAMETER, *this);
+        };
+    };
 
             
     inOut->logMain << "Finished loading and checking parameters\n" <<flush;
@@ -776,13 +881,14 @@ int Parameters::scanOneLine (string &lineIn, int inputLevel, int inputLevelReque
 void Parameters::chrInfoLoad() {//find chrStart,Length,nChr from Genome G
     
     //load chr names
-    ifstream chrStreamIn ( (genomeDir+"/chrName.txt").c_str() );   
-    if (chrStreamIn.fail()) {
+    string chrText;
+    if (!genomeIndex.textRead("chrName.txt", chrText)) {
         ostringstream errOut;                            
         errOut << "EXITING because of FATAL error, could not open file " << (genomeDir+"/chrName.txt") <<"\n";
         errOut << "SOLUTION: re-generate genome files with STAR --runMode genomeGenerate\n";
         exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_INPUT_FILES, *this);
     };
+    istringstream chrStreamIn(chrText);
     
     while (chrStreamIn.good()) {
         string chrIn;
@@ -792,7 +898,6 @@ void Parameters::chrInfoLoad() {//find chrStart,Length,nChr from Genome G
         if (chrIn=="") break;
         chrName.push_back(chrIn);
     };        
-    chrStreamIn.close();
     nChrReal=chrName.size();
 
     inOut->logMain << "Number of real (reference) chromosmes= " << nChrReal <<"\n"<<flush;
@@ -800,32 +905,32 @@ void Parameters::chrInfoLoad() {//find chrStart,Length,nChr from Genome G
     chrLength.resize(nChrReal);
   
     //load chr lengths
-    chrStreamIn.open( (genomeDir+"/chrLength.txt").c_str() );   
-    if (chrStreamIn.fail()) {
+    if (!genomeIndex.textRead("chrLength.txt", chrText)) {
         ostringstream errOut;                            
         errOut << "EXITING because of FATAL error, could not open file " << (genomeDir+"/chrLength.txt") <<"\n";
         errOut << "SOLUTION: re-generate genome files with STAR --runMode genomeGenerate\n";
         exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_INPUT_FILES, *this);  
     };
+    chrStreamIn.clear();
+    chrStreamIn.str(chrText);
     
     for  (uint ii=0;ii<nChrReal;ii++) {
         chrStreamIn >> chrLength[ii];
     };    
-    chrStreamIn.close();    
     
     //load chr starts
-    chrStreamIn.open( (genomeDir+"/chrStart.txt").c_str() );   
-    if (chrStreamIn.fail()) {
+    if (!genomeIndex.textRead("chrStart.txt", chrText)) {
         ostringstream errOut;                            
         errOut << "EXITING because of FATAL error, could not open file " << (genomeDir+"/chrStart.txt") <<"\n";
         errOut << "SOLUTION: re-generate genome files with STAR --runMode genomeGenerate\n";        
         exitWithError(errOut.str(),std::cerr, inOut->logMain, EXIT_CODE_INPUT_FILES, *this);
     };   
+    chrStreamIn.clear();
+    chrStreamIn.str(chrText);
     
     for  (uint ii=0;ii<=nChrReal;ii++) {
         chrStreamIn >> chrStart[ii];
     };    
-    chrStreamIn.close();    
   
     //log
     for (uint ii=0; ii<nChrReal;ii++) {
@@ -4,6 +4,7 @@
 #include "IncludeDefine.h"
 #include "InOutStreams.h"
 #include "ParameterInfo.h"
+#include "GenomeIndexFile.h"
 #include <map>
 
 class Parameters {
@@ -21,6 +22,7 @@ class Parameters {
         // run parameters
         string runMode;
         int   runThreadN;
+        string serverSocket; //Unix domain socket of the alignment server
     
         //parameters
         vector <string> parametersFiles;
@@ -28,8 +30,16 @@ class Parameters {
         //genome, SA, ...
         vector <uint> chrStart, chrLength;
         string genomeDir,genomeLoad;
+        string genomeMmapPopulate, genomeMmapAdvise; //options for genomeLoad=Mmap
+        string genomeHugePages; //page size for the genome arrays: None, 2MB, 1GB
+        string genomeNUMA; //placement of the genome on NUMA nodes: None, Replicate, Interleave
         vector <string> genomeFastaFiles; 
         uint genomeSAsparseD;//sparsity=distance between indices
+        string genomeSAlcp;//LCP array of the neighboring suffixes: None or Byte
+        string genomePacked;//packed copy of the genome for the seed search and extension: None or 2bit
+        string genomeSAlayout;//bits per SA element: Packed, 40bit or 64bit
+        string genomeIndexFile;//single-file genome index to generate: None, Add, Only
+        GenomeIndexFile genomeIndex;//the genome files are read from the index file if it is present in genomeDir
         //binning,windows,anchors
         uint genomeChrBinNbits, genomeChrBinNbases, chrBinN, *chrBin;
         uint winBinChrNbits, winBinNbits, winAnchorDistNbins, winFlankNbins, winBinN;
@@ -63,6 +73,8 @@ class Parameters {
         uint alignIntronMax;//max length to call 
         uint alignMatesGapMax;//max gap between the mates (if paired-end)
         string alignEndsType;
+        uint alignDuplicatesCacheN; //number of slots in the alignment cache of the duplicate reads, 0: no cache
+        int alignLongReads; //1: stitching for long reads, 0: for short reads, -1: DEF_alignLongReads
         
         //seed parameters
         uint seedMultimapNmax; //max number of multiple alignments per piece          
@@ -90,6 +102,7 @@ class Parameters {
         int outBAMcompression;
         vector <string> outSAMtype;
         bool outBAMunsorted, outBAMcoord, outBAMbool;
+        uint outBAMsortingBinsN;//number of coordinate bins for sorting
         
         string outReadsUnmapped;
         int outQSconversionAdd;
@@ -116,6 +129,9 @@ class Parameters {
         uint limitIObufferSize; //max size of the in/out buffer, bytes
         uint limitOutSAMoneReadBytes;
         uint limitOutSJoneRead, limitOutSJcollapsed;
+        uint limitBAMsortRAM;
+        uint limitReadSeqLength; //max read length, sum of the mates lengths, for the per-thread read buffers
+        int limitAlignExonsN; //max number of exons per alignment, -1: MAX_N_EXONS or MAX_N_EXONS_LONG_READS
         
         // penalties
         intScore scoreGap, scoreGapNoncan, scoreGapGCAG, scoreGapATAC, scoreDelBase, scoreDelOpen, scoreInsBase, scoreInsOpen; 
@@ -129,7 +145,6 @@ class Parameters {
         uint swMode, swWinCoverageMinP;
         //SW penalties
         uint swPeoutFilterMatchNmin, swPenMismatch, swPenGapOpen, swPenGapExtend;
-        uint swHsize;        
         
         int annotScoreScale;//overall multiplication factor for the annotation
         string annotSignalFile;//binary file with annotation signal
@@ -8,6 +8,8 @@ ReadAlign::ReadAlign (Parameters* Pin, const Genome &genomeIn) : P(Pin) {//alloc
     G=genomeIn.G;
     SA=genomeIn.SA;
     SAi=genomeIn.SAi;
+    SAlcp=genomeIn.SAlcp;
+    Gpacked=genomeIn.Gpacked;
     sigG=genomeIn.sigG;
     
     winBin = new uintWinBin* [2];  
@@ -15,6 +17,12 @@ ReadAlign::ReadAlign (Parameters* Pin, const Genome &genomeIn) : P(Pin) {//alloc
     winBin[1] = new uintWinBin [P->winBinN];      
     memset(winBin[0],255,sizeof(winBin[0][0])*P->winBinN);
     memset(winBin[1],255,sizeof(winBin[0][0])*P->winBinN);
+    winBinDirty[0].reserve(4*P->alignWindowsPerReadNmax);
+    winBinDirty[1].reserve(4*P->alignWindowsPerReadNmax);
+    seedChains.reserve(4*P->maxNsplit);
+    seeds.reserve(P->seedPerReadNmax);
+    seedActive.reserve(4*P->maxNsplit);
+    seedActiveNext.reserve(4*P->maxNsplit);
     
     
     
@@ -33,59 +41,77 @@ ReadAlign::ReadAlign (Parameters* Pin, const Genome &genomeIn) : P(Pin) {//alloc
     WALrec=new uint[P->alignWindowsPerReadNmax];
     WlastAnchor=new uint[P->alignWindowsPerReadNmax];
 
-#ifdef COMPILE_FOR_LONG_READS
-    swWinCov = new uint[P->alignWindowsPerReadNmax];
+    if (P->alignLongReads==1 || P->swMode==1) {
+        swWinCov = new uint[P->alignWindowsPerReadNmax];
+    };
 
     if (P->swMode==1) {
         swWinGleft = new uint[P->alignWindowsPerReadNmax];
         swWinGright = new uint[P->alignWindowsPerReadNmax];
         swWinRleft = new uint[P->alignWindowsPerReadNmax];
         swWinRright = new uint[P->alignWindowsPerReadNmax];
-        P->swHsize=5000000000LLU;
-        swT = new char [P->swHsize];
     };
     
-    scoreSeedToSeed = new intScore [P->seedPerWindowNmax*(P->seedPerWindowNmax+1)/2];
-    scoreSeedBest = new intScore [P->seedPerWindowNmax];
-    scoreSeedBestInd = new uint [P->seedPerWindowNmax];
-    scoreSeedBestMM = new uint [P->seedPerWindowNmax];
-    seedChain = new uint [P->seedPerWindowNmax];
-    
-#endif
+    if (P->alignLongReads==1) {//seed-to-seed stitching of the long reads
+        scoreSeedToSeed = new intScore [P->seedPerWindowNmax*(P->seedPerWindowNmax+1)/2];
+        scoreSeedBest = new intScore [P->seedPerWindowNmax];
+        scoreSeedBestInd = new uint [P->seedPerWindowNmax];
+        scoreSeedBestMM = new uint [P->seedPerWindowNmax];
+        seedChain = new uint [P->seedPerWindowNmax];
+    };
     
-    WA=new uiWA*[P->alignWindowsPerReadNmax];
-    for (uint ii=0;ii<P->alignWindowsPerReadNmax;ii++) WA[ii]=new uiWA[P->seedPerWindowNmax];
+    WA=new uiWA*[P->alignWindowsPerReadNmax]; //the aligns of each window are allocated in readArena
 
     WAincl = new bool [P->seedPerWindowNmax];    
+    stitchStack = new StitchState [P->seedPerWindowNmax+1];
+    trStitch = new Transcript [P->seedPerWindowNmax+1];
    
     trAll = new Transcript**[P->alignWindowsPerReadNmax+1];
+    trWinArray = new Transcript[P->alignTranscriptsPerWindowNmax+1];
+    trWin = new Transcript*[P->alignTranscriptsPerWindowNmax+1];
 
     nWinTr = new uint[P->alignWindowsPerReadNmax];
     
-    trArray = new Transcript[P->alignTranscriptsPerReadNmax];
-    trArrayPointer =  new Transcript*[P->alignTranscriptsPerReadNmax];
-    for (uint ii=0;ii<P->alignTranscriptsPerReadNmax;ii++) trArrayPointer[ii]= &(trArray[ii]);
-    
     
     trInit = new Transcript;
+    alignCache = NULL;
     
     //read
-    Read0 = new char*[2];    
-    Read0[0]  = new char [DEF_readSeqLengthMax+1];
-    Read0[1]  = new char [DEF_readSeqLengthMax+1];
+    Read0buffer = new char*[2];
+    Read0buffer[0]  = new char [P->limitReadSeqLength+1];
+    Read0buffer[1]  = new char [P->limitReadSeqLength+1];
 
-    Qual0 = new char*[2];
-    Qual0[0]  = new char [DEF_readSeqLengthMax+1];
-    Qual0[1]  = new char [DEF_readSeqLengthMax+1];
+    Qual0buffer = new char*[2];
+    Qual0buffer[0]  = new char [P->limitReadSeqLength+1];
+    Qual0buffer[1]  = new char [P->limitReadSeqLength+1];
+
+    outSeqMate = new char [P->limitReadSeqLength+1];
+    outQualMate = new char [P->limitReadSeqLength+1];
+
+    readNameMatesBuffer=new char* [P->readNmates];
+    for (uint ii=0; ii<P->readNmates; ii++) readNameMatesBuffer[ii]=new char [DEF_readNameLengthMax];
 
+    //the pointers are re-assigned for each read if the reads are parsed in the input chunks
+    Read0 = new char*[2];
+    Qual0 = new char*[2];
     readNameMates=new char* [P->readNmates];
-    for (uint ii=0; ii<P->readNmates; ii++) readNameMates[ii]=new char [DEF_readNameLengthMax];
-    
+    for (uint ii=0; ii<2; ii++) {
+        Read0[ii]=Read0buffer[ii];
+        Qual0[ii]=Qual0buffer[ii];
+    };
+    for (uint ii=0; ii<P->readNmates; ii++) {
+        readNameMates[ii]=readNameMatesBuffer[ii];
+        readInStream[ii]=NULL;
+        readInChunk[ii]=NULL;
+    };
+
     readName = readNameMates[0];
     Read1 = new char*[3];
-    Read1[0]=new char[DEF_readSeqLengthMax+1]; Read1[1]=new char[DEF_readSeqLengthMax+1]; Read1[2]=new char[DEF_readSeqLengthMax+1];    
+    Read1[0]=new char[P->limitReadSeqLength+1]; Read1[1]=new char[P->limitReadSeqLength+1]; Read1[2]=new char[P->limitReadSeqLength+1];    
     Qual1=new char*[2]; //modified QSs for scoring
-    Qual1[0]=new char[DEF_readSeqLengthMax+1]; Qual1[1]=new char[DEF_readSeqLengthMax+1];
+    Qual1[0]=new char[P->limitReadSeqLength+1]; Qual1[1]=new char[P->limitReadSeqLength+1];
+    readKey[0]=new uint[P->limitReadSeqLength+1]; readKey[1]=new uint[P->limitReadSeqLength+1];
+    readNcum=new uint[P->limitReadSeqLength+1];
     
     resetN();
     
@@ -4,9 +4,13 @@
 #include "IncludeDefine.h"
 #include "Parameters.h"
 #include "Transcript.h"
+#include "ReadArena.h"
 #include "Genome.h"
 #include "Stats.h"
 #include "OutSJ.h"
+#include "alignSmithWaterman.h"
+#include "AlignCache.h"
+#include "SuffixArraySearch.h"
 #include <time.h>
 
 class ReadAlign : public Genome {
@@ -22,6 +26,7 @@ class ReadAlign : public Genome {
         
         //input,output
         istream* readInStream[MAX_N_MATES];
+        char* readInChunk[MAX_N_MATES]; //next read in the input chunks, reads are parsed in place; NULL if reads are loaded from readInStream
         ostream* outSAMstream;
         OutSJ *chunkOutSJ, *chunkOutSJ1;
         fstream chunkOutChimSAM, chunkOutChimJunction, chunkOutUnmappedReadsStream[MAX_N_MATES], chunkOutFilterBySJoutFiles[MAX_N_MATES];
@@ -37,8 +42,8 @@ class ReadAlign : public Genome {
 //         StatsAll *statsRA;
         
         //transcript
-        Transcript* trArray; //linear array of transcripts to store all of them from all windows
-        Transcript** trArrayPointer; //linear array of transcripts to store all of them from all windows            
+        ReadArena readArena; //per-read storage of the window aligns and of the compact window transcripts, reset for each read
+        Transcript *trWinArray, **trWin; //full transcripts of the window being stitched, alignTranscriptsPerWindowNmax+1
         
         //read
         uint iRead, iMate;
@@ -52,8 +57,11 @@ class ReadAlign : public Genome {
         char** Qual0;
         char** readNameMates;
         char* readName;
+        char **Read0buffer, **Qual0buffer, **readNameMatesBuffer; //storage for reads loaded from readInStream, and for fasta qualities
+        char *outSeqMate, *outQualMate; //reverse-complemented mate sequence and qualities for the SAM/BAM output
         char** Read1;
         char** Qual1; //modified QSs for scoring
+        uint *readKey[2], *readNcum; //rolling 2-bit codes of the read prefixes, forward and reverse complement, for the SA index keys; number of non-ACGT bases before each position
         
         //split            
         uint** splitR;
@@ -63,7 +71,27 @@ class ReadAlign : public Genome {
         
         //binned alignments
         uintWinBin **winBin; //binned genome: window ID (number) per bin
-        
+        vector <uint> winBinDirty[2]; //start,end pairs of the winBin ranges modified for the current read, per strand
+        vector <uint> saDecoded; //SA values of the SA ranges of all pieces of the current read, in the order of the pieces
+        
+        //seed search
+        struct SeedChain {//consecutive seeds along one piece of the read, in one direction, from one start
+            uint ip, iDir, istart, Lstart; //piece, direction, start number, distance between the starts
+            bool fixedLength; //one seed of seedSearchLmax length
+            uint Lmapped, seedN, seedFirst, seedLast; //read length covered by the seeds, number of seeds, first and last seed
+            uint chainDir; //chain in the opposite direction, needed only if the 1st seed of this chain does not map the full piece; -1 if none
+        };
+        struct Seed {
+            uint iChain, Shift, length, iDir; //chain, start in the read, length, direction
+            uint searchStart, searchN; //suffix array searches for all sparse SA distances
+            uint L, seedNext; //max mappable length, next seed in the chain
+        };
+        vector <SeedChain> seedChains;
+        vector <Seed> seeds;
+        vector <uint> seedActive, seedActiveNext; //seeds with searches in progress
+        vector <SuffixArraySearch> saSearch;
+        vector <uint> saSearchSAstr; //SA values of the next comparison for each search
+
         //alignments
         uiPC *PC; //pieces coordinates
         uiWC *WC; //windows coordinates        
@@ -75,9 +103,17 @@ class ReadAlign : public Genome {
         uint nA, nP, nW, nWall, nUM[2]; //number of all alignments,  pieces, windows, U/M, 
         uint *nWA, *nWAP, *WALrec, *WlastAnchor; //number of alignments per window, per window per piece, min recordable length per window
         bool *WAincl; //alginment inclusion mask
+
+        struct StitchState {//one level of the include/exclude search in stitchWindowAligns
+            uint iA, tR2, tG2, iTr; //next align, transcript end in the read and genome, transcript slot in trStitch
+            int Score;
+            bool includeDone; //the branch with the align iA included has been explored
+        };
+        StitchState *stitchStack; //search stack, one level per align
+        Transcript *trStitch; //transcripts of the search, one per number of included aligns
         
         uint *swWinCov, *swWinGleft, *swWinGright, *swWinRleft, *swWinRright; //read coverage per window
-        char *swT;
+        SWbuffers swBuf; //Smith-Waterman work arrays
         
         uint storedLmin, uniqLmax, uniqLmaxInd, multLmax, multLmaxN, multNmin, multNminL, multNmax, multNmaxL;
         uint nTr, nTrMate; // number of transcripts called
@@ -94,12 +130,19 @@ class ReadAlign : public Genome {
         
         intScore trMultScores[MAX_N_MULTMAP];//scores for the multiple mappers
         Transcript* trMult[MAX_N_MULTMAP];//multimapping transcripts
+        vector <Transcript> trMultArray; //full copies of the multimapping transcripts, trMult points to them after multMapSelect
+
+        AlignCache *alignCache; //alignments of the duplicate reads, shared by all threads; NULL: no cache
+        string alignCacheKey; //sequence of the read and the mates lengths
                
         ReadAlign (Parameters* Pin, const Genome &genomeIn);//allocate arrays
         void resetN();//resets the counters to 0
         void multMapSelect();
         int mapOneRead();
-        uint maxMappableLength2strands(uint pieceStart, uint pieceLength, uint iDir, uint iSA1, uint iSA2, uint& maxL, uint iFrag);
+        void seedSearchBatch();//search all seeds of the read
+        void seedChainNext(uint iChain);//start the next seed of the chain
+        void seedFinish(uint iSeed);
+        uint maxMappableLength2strands(uint pieceStart, uint pieceLength, uint iDir, uint iSearch);//start the searches of one seed
         void storeAligns (uint iDir, uint Shift, uint Nrep, uint L, uint indStartEnd[2], uint iFrag);
         
         bool outputTranscript(Transcript *trOut, uint nTrOut, ofstream *outBED);
@@ -110,6 +153,10 @@ class ReadAlign : public Genome {
         string outputTranscriptCIGARp(Transcript const &trOut);
         void outTxtMain(ofstream*,Transcript&);
         int createExtendWindowsWithAlign(uint a1, uint aStr); //extends and windows with one alignment
+        void winBinMarkDirty(uint aStr, uint binStart, uint binEnd) {//record the modified winBin range, to be reset for the next read
+            winBinDirty[aStr].push_back(binStart);
+            winBinDirty[aStr].push_back(binEnd);
+        };
         void assignAlignToWindow(uint a1, uint aLength, uint aStr, uint aNrep, uint aFrag, uint aRstart,bool aAnchor, uint sjA); //assigns one alignment to a window
         void stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint Lread);
         void outputAlignments();
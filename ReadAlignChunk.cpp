@@ -1,20 +1,25 @@
 #include "ReadAlignChunk.h"
 #include <pthread.h>
 #include "ErrorWarning.h"
+#include "BAMfunctions.h"
 
 ReadAlignChunk::ReadAlignChunk(Parameters* Pin, Genome &genomeIn, int iChunk) : P(Pin) {//initialize chunk
     
     RA = new ReadAlign(P,genomeIn);//new local copy of RA for each chunk
+
+    if (genomeIn.numaNodeN>0) {//threads are distributed over the nodes, and use the local genome copy
+        numaNode=iChunk % genomeIn.numaNodeN;
+        numaCPUs=genomeIn.numaNodeCPUs[numaNode];
+        genomeIn.numaReplicaAssign(numaNode, *RA);
+    } else {
+        numaNode=-1;
+    };
     
     chunkIn=new char* [P->readNmates];
-    readInStream=new istringstream* [P->readNmates];
-//     readInStream=new istringstream* [P->readNmates];
     for (uint ii=0;ii<P->readNmates;ii++) {
        chunkIn[ii]=new char[P->chunkInSizeBytesArray];//reserve more space to finish loading one read
        memset(chunkIn[ii],'\n',P->chunkInSizeBytesArray);
-       readInStream[ii] = new istringstream;
-       readInStream[ii]->rdbuf()->pubsetbuf(chunkIn[ii],P->chunkInSizeBytesArray);
-       RA->readInStream[ii]=readInStream[ii];
+       RA->readInChunk[ii]=chunkIn[ii];
     };
     
     chunkOutSAM=new char [P->chunkOutSAMsizeBytes];
@@ -24,12 +29,24 @@ ReadAlignChunk::ReadAlignChunk(Parameters* Pin, Genome &genomeIn, int iChunk) :
     RA->outSAMstream=chunkOutSAMstream;
     RA->outSAMstream->seekp(0,ios::beg);
     chunkOutSAMtotal=0;
+
+    if (P->outBAMunsorted) {
+        chunkOutBAMbgzf=new char [bgzfCompressBlocksMaxSize(P->chunkOutSAMsizeBytes)];
+    } else {
+        chunkOutBAMbgzf=NULL;
+    };
     
     chunkOutSJ=new OutSJ (P->limitOutSJcollapsed, P);
     chunkOutSJ1=new OutSJ (P->limitOutSJcollapsed, P);
 
     RA->chunkOutSJ=chunkOutSJ;
     RA->chunkOutSJ1=chunkOutSJ1;
+
+    if (P->outBAMcoord) {
+        chunkOutBAMcoord=new BAMoutput (iChunk, P);
+    } else {
+        chunkOutBAMcoord=NULL;
+    };
     
     if (P->chimSegmentMin>0) {
         chunkFstreamOpen(P->outFileTmp + "/Chimeric.out.sam.thread", iChunk, RA->chunkOutChimSAM);
@@ -5,6 +5,7 @@
 #include "Parameters.h"
 #include "ReadAlign.h"
 #include "OutSJ.h"
+#include "BAMoutput.h"
 
 class ReadAlignChunk {//chunk of reads and alignments
 public:
@@ -13,9 +14,10 @@ public:
     
     char** chunkIn; //space for the chunk of input reads
     char*  chunkOutSAM;//space for the chunk of output SAM
+    char*  chunkOutBAMbgzf;//space for the compressed chunk of output BAM
     OutSJ *chunkOutSJ, *chunkOutSJ1;
+    BAMoutput *chunkOutBAMcoord;//coordinate bins for sorted BAM output
     
-    istringstream** readInStream;
     ostringstream*  chunkOutSAMstream;
     ofstream chunkOutSAMfile;
     string chunkOutSAMfileName;
@@ -25,6 +27,8 @@ public:
     uint iChunkOutSAM; //current chunk # writtedn to Aligned.out.sam
     int iThread; //current thread
     uint chunkOutSAMtotal; //total number of bytes in the write buffer
+    int numaNode; //NUMA node of the thread, -1 if the thread is not bound
+    vector <int> numaCPUs; //CPUs of the node
             
     ReadAlignChunk(Parameters* Pin, Genome &genomeIn, int iChunk);
     void processChunks();
@@ -2,16 +2,12 @@
 #include "GlobalVariables.h"
 #include "ThreadControl.h"
 #include "ErrorWarning.h"
+#include "BAMfunctions.h"
 #include SAMTOOLS_BGZF_H
 
-void ReadAlignChunk::mapChunk() {//map one chunk. Input reads stream has to be setup in RA->readInStream[ii]
+void ReadAlignChunk::mapChunk() {//map one chunk. Input reads have to be setup in RA->readInChunk[ii], or RA->readInStream[ii] if RA->readInChunk[ii]==NULL
     RA->statsRA.resetN();       
     
-    for (uint ii=0;ii<P->readNmates;ii++) {//clear eof and rewind the input streams
-        RA->readInStream[ii]->clear();
-        RA->readInStream[ii]->seekg(0,ios::beg);
-    };
-    
     if ( P->outSAMorder == "PairedKeepInputOrder" && P->runThreadN>1 ) {//open chunk file
         ostringstream name1("");
         name1 << P->outFileTmp + "/Aligned.tmp.sam.chunk"<<iChunkIn;
@@ -20,6 +16,7 @@ void ReadAlignChunk::mapChunk() {//map one chunk. Input reads stream has to be s
     };    
     
     int readStatus=0;
+    uint iReadChunk=0;//read number inside the chunk
     while (readStatus==0) {//main cycle over all reads
 
         readStatus=RA->oneRead(); //map one read
@@ -29,6 +26,12 @@ void ReadAlignChunk::mapChunk() {//map one chunk. Input reads stream has to be s
 //         chunkOutSAMtotal=(uint) RA->outSAMstream->tellp();
             chunkOutSAMtotal+=RA->outSAMbytes;
 //             uint ddd=(uint) RA->outSAMstream->tellp();            
+            if (P->outBAMcoord) {//distribute the alignments of this read into the coordinate bins
+                for (char* bam1=RA->outBAMarray-RA->outSAMbytes; bam1<RA->outBAMarray; bam1+=*((uint32*) bam1)+sizeof(uint32)) {
+                    chunkOutBAMcoord->coordOneAlign(bam1, *((uint32*) bam1)+sizeof(uint32), (iChunkIn<<32) | iReadChunk);
+                };
+            };
+            iReadChunk++;
         };
 
         //write SAM aligns to chunk buffer 
@@ -48,13 +51,28 @@ void ReadAlignChunk::mapChunk() {//map one chunk. Input reads stream has to be s
                     P->inOut->outSAM->write(chunkOutSAM,chunkOutSAMtotal);
                     P->inOut->outSAM->clear();//in case 0 bytes were written which could set fail bit
                     if (P->runThreadN>1) pthread_mutex_unlock(&g_threadChunks.mutexOutSAM);
-                } else if (P->outBAMunsorted) {//no sort output
-                    if (P->runThreadN>1) pthread_mutex_lock(&g_threadChunks.mutexOutSAM);  
-                    bgzf_write(P->inOut->outBAMfileUnsorted,chunkOutSAM,chunkOutSAMtotal);
+                } else {//BAM output
+                    if (P->outBAMunsorted) {//no sort output
+                        //compress in this thread, only writing of the compressed blocks is done under the mutex
+                        uint bgzfBytes=bgzfCompressBlocks(chunkOutSAM,chunkOutSAMtotal,chunkOutBAMbgzf,P->outBAMcompression);
+                        if (bgzfBytes==0 && chunkOutSAMtotal>0) {
+                            ostringstream errOut;
+                            errOut <<"EXITING because of fatal error: BGZF compression of the BAM output failed\n";
+                            errOut <<"Solution: check the value of the --outBAMcompression parameter\n";
+                            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+                        };
+                        if (P->runThreadN>1) pthread_mutex_lock(&g_threadChunks.mutexOutSAM);  
+                        uint bgzfBytesWritten=fwrite(chunkOutBAMbgzf,1,bgzfBytes,(FILE*) P->inOut->outBAMfileUnsorted->fp);
+                        if (P->runThreadN>1) pthread_mutex_unlock(&g_threadChunks.mutexOutSAM);
+                        if (bgzfBytesWritten!=bgzfBytes) {
+                            ostringstream errOut;
+                            errOut <<"EXITING because of fatal error: could not write to the BAM file " << P->outFileNamePrefix << "Aligned.out.bam\n";
+                            errOut <<"Solution: check that the disk is not full and you have permission to write this file\n";
+                            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+                        };
+                    };
+                    //sorting by coordinate: the alignments were already distributed into bins after each read
                     RA->outBAMarray=chunkOutSAM;
-                    if (P->runThreadN>1) pthread_mutex_unlock(&g_threadChunks.mutexOutSAM);
-                } else if (P->outBAMcoord) {//sorting by coordinate
-                    
                 };
             };
 //             cout << RA->outSAMstream->tellp() <<"   "<< chunkOutSAMtotal <<"\n";
@@ -110,6 +128,7 @@ void ReadAlignChunk::mapChunk() {//map one chunk. Input reads stream has to be s
     //add stats, write progress if needed
     if (P->runThreadN>1) pthread_mutex_lock(&g_threadChunks.mutexStats);
     g_statsAll.addStats(RA->statsRA);
+    if (numaNode>=0) g_statsAll.numaReadN[numaNode]+=RA->statsRA.readN;
     g_statsAll.progressReport(P->inOut->logProgress);
     if (P->runThreadN>1) pthread_mutex_unlock(&g_threadChunks.mutexStats); 
 };            
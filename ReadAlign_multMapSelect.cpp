@@ -47,7 +47,11 @@ void ReadAlign::multMapSelect() {//select multiple mappers from all transcripts
         };
     };
     
-    for (uint iTr=0; iTr<nTr; iTr++) {//scan transcripts                 
+    if (trMultArray.size()<nTr) trMultArray.resize(nTr);
+    for (uint iTr=0; iTr<nTr; iTr++) {//scan transcripts, materialize the compact transcripts of the windows into full copies for the output
+        trMultArray[iTr]=*trMult[iTr];
+        if (trMult[iTr]==trBest) trBest=&trMultArray[iTr];
+        trMult[iTr]=&trMultArray[iTr];
         trMult[iTr]->roStart = trMult[iTr]->roStr==0 ? trMult[iTr]->rStart : Lread - trMult[iTr]->rStart - trMult[iTr]->rLength;
         trMult[iTr]->cStart=trMult[iTr]->gStart - P->chrStart[trMult[iTr]->Chr];                        
     };
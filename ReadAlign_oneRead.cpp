@@ -5,13 +5,24 @@
 
 int ReadAlign::oneRead() {//process one read: load, map, write
 
-    //load read name, sequence, quality from the streams into internal arrays
+    //load read name, sequence, quality from the input chunks or streams
     int readStatus[2];
     
-    readStatus[0]=readLoad(*(readInStream[0]), P, 0, readLength[0], readLengthOriginal[0], readNameMates[0], Read0[0], Read1[0], Qual0[0], Qual1[0], clip3pNtotal[0], clip5pNtotal[0], clip3pAdapterN[0]);
-    if (P->readNmates==2) {//read the 2nd mate
-        readStatus[1]=readLoad(*(readInStream[1]), P, 1, readLength[1], readLengthOriginal[1], readNameMates[1], Read0[1], Read1[0]+readLength[0]+1, Qual0[1], Qual1[0]+readLength[0]+1, clip3pNtotal[1], clip5pNtotal[1], clip3pAdapterN[1] );
-        
+    for (uint imate=0; imate<P->readNmates; imate++) {
+        char *Read1mate=(imate==0 ? Read1[0] : Read1[0]+readLength[0]+1);
+        char *Qual1mate=(imate==0 ? Qual1[0] : Qual1[0]+readLength[0]+1);
+        if (readInChunk[imate]!=NULL) {//parse the read in the input chunk
+            readStatus[imate]=readLoad(readInChunk[imate], P, imate, readLength[imate], readLengthOriginal[imate], readNameMates[imate], Read0[imate], Read1mate, Qual0[imate], Qual0buffer[imate], Qual1mate, clip3pNtotal[imate], clip5pNtotal[imate], clip3pAdapterN[imate]);
+        } else {//load the read from the stream
+            readNameMates[imate]=readNameMatesBuffer[imate];
+            Read0[imate]=Read0buffer[imate];
+            Qual0[imate]=Qual0buffer[imate];
+            readStatus[imate]=readLoad(*(readInStream[imate]), P, imate, readLength[imate], readLengthOriginal[imate], readNameMates[imate], Read0[imate], Read1mate, Qual0[imate], Qual1mate, clip3pNtotal[imate], clip5pNtotal[imate], clip3pAdapterN[imate]);
+        };
+    };
+    readName=readNameMates[0];
+
+    if (P->readNmates==2) {//combine the mates
         if (readStatus[0]!=readStatus[1]) {
             ostringstream errOut;
             errOut << "EXITING because of FATAL ERROR: Read1 and Read2 are not consistent, reached the end of the one before the other one\n";
@@ -24,11 +35,11 @@ int ReadAlign::oneRead() {//process one read: load, map, write
         //combine two reads together
         Lread=readLength[0]+readLength[1]+1;
         readLengthPairOriginal=readLengthOriginal[0]+readLengthOriginal[1]+1;    
-        if (Lread>DEF_readSeqLengthMax) {
+        if (Lread>P->limitReadSeqLength) {
             ostringstream errOut;
-            errOut << "EXITING because of FATAL ERROR in reads input: Lread of the pair = " << Lread << "   while DEF_readSeqLengthMax=" << DEF_readSeqLengthMax <<endl;
+            errOut << "EXITING because of FATAL ERROR in reads input: Lread of the pair = " << Lread << "   while limitReadSeqLength=" << P->limitReadSeqLength <<endl;
             errOut << "Read Name="<<readNameMates[0]<<endl;
-            errOut << "SOLUTION: increase DEF_readSeqLengthMax in IncludeDefine.h and re-compile STAR"<<endl<<flush;
+            errOut << "SOLUTION: increase --limitReadSeqLength"<<endl<<flush;
             exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);                      
         };                  
         
@@ -59,12 +70,48 @@ int ReadAlign::oneRead() {//process one read: load, map, write
         Read1[2][Lread-ii-1]=Read1[1][ii];
         Qual1[1][Lread-ii-1]=Qual1[0][ii];
     };
+
+    //rolling codes for the SA index keys: the key of any read substring is obtained from two prefix codes
+    readKey[0][0]=0; readKey[1][0]=0; readNcum[0]=0;
+    for (uint ii=0;ii<Lread;ii++) {
+        char b1=Read1[0][ii], b2=Read1[0][Lread-1-ii];
+        readKey[0][ii+1] = (readKey[0][ii]<<2) + (b1<4 ? b1 : 0);
+        readKey[1][ii+1] = (readKey[1][ii]<<2) + (b2<4 ? 3-b2 : 0); //reverse complement
+        readNcum[ii+1] = readNcum[ii] + (b1<4 ? 0 : 1);
+    };
     
     statsRA.readN++;
     statsRA.readBases += readLength[0]+readLength[1];
     
-    //map the read
-    mapOneRead();
+    //map the read, or take the alignments of the same read sequence from the cache
+    if (alignCache==NULL) {
+        mapOneRead();
+    } else {
+        alignCacheKey.assign(Read1[0], Lread);
+        alignCacheKey.append((char*) readLength, sizeof(readLength[0])); //the mates split and the original length are recorded in the transcripts
+        alignCacheKey.append((char*) &readLengthPairOriginal, sizeof(readLengthPairOriginal));
+
+        AlignCacheRecord cacheRec;
+        if (alignCache->get(alignCacheKey, cacheRec, trMultArray, trMultScores)) {
+            statsRA.alignCacheHitN++;
+            nW=cacheRec.nW; nTr=cacheRec.nTr; nTrMate=cacheRec.nTrMate; maxScore=cacheRec.maxScore;
+            for (uint iTr=0; iTr<nTr; iTr++) {
+                trMult[iTr]=&trMultArray[iTr];
+                trMult[iTr]->iRead=iRead;
+            };
+            trBest=trMult[cacheRec.iTrBest];
+        } else {
+            double timeMap=omp_get_wtime();
+            mapOneRead();
+            statsRA.alignCacheMissTime += omp_get_wtime()-timeMap;
+            statsRA.alignCacheMissN++;
+            if (nW>0) {//the alignments were selected by multMapSelect, trBest is one of trMult
+                cacheRec.nW=nW; cacheRec.nTr=nTr; cacheRec.nTrMate=nTrMate; cacheRec.maxScore=maxScore;
+                for (cacheRec.iTrBest=0; cacheRec.iTrBest<nTr && trMult[cacheRec.iTrBest]!=trBest; cacheRec.iTrBest++) {};
+                if (cacheRec.iTrBest<nTr) alignCache->put(alignCacheKey, cacheRec, trMult, trMultScores);
+            };
+        };
+    };
     
     //write out alignments
     outputAlignments();
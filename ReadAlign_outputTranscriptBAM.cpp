@@ -334,7 +334,7 @@ uint ReadAlign::outputTranscriptBAM(Transcript const &trOut, uint nTrOut, uint i
             };
         };
 ////////////////////////////// prepare sequence and qualities        
-        char seqMate[DEF_readSeqLengthMax+1], qualMate[DEF_readSeqLengthMax+1];
+        char *seqMate=outSeqMate, *qualMate=outQualMate;
         char *seqOut=NULL, *qualOut=NULL;
 
         if ( Mate==Str)  {//seq strand is correct, or mate is unmapped
@@ -156,7 +156,7 @@ uint ReadAlign::outputTranscriptSAM(Transcript const &trOut, uint nTrOut, uint i
         CIGAR=samStreamCIGAR.str();
 
            
-        char seqMate[DEF_readSeqLengthMax+1], qualMate[DEF_readSeqLengthMax+1];
+        char *seqMate=outSeqMate, *qualMate=outQualMate;
         char *seqOut=NULL, *qualOut=NULL;
 
         if ( Mate==Str )  {//seq strand is correct
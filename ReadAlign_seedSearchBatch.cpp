@@ -0,0 +1,165 @@
+#include "ReadAlign.h"
+
+void ReadAlign::seedSearchBatch() {
+    //search all seeds of the read. Seeds are chained along each piece of the read, for each direction and start; the next seed in a chain
+    //starts where the previous one stopped, but different chains are independent. The SA searches of all chains are advanced in lockstep:
+    //the SA words and then the genome sequences for the next comparison of all active searches are prefetched before any of them is evaluated.
+    //The alignments are stored in the order of the sequential search, i.e. piece, direction, start, seeds in the chain
+
+    seedChains.clear();
+    seeds.clear();
+    saSearch.clear();
+    saSearchSAstr.clear();
+    seedActiveNext.clear();
+
+    uint seedSearchStartLmax=min(P->seedSearchStartLmax,(uint) (P->seedSearchStartLmaxOverLread*(Lread-1)));
+    for (uint ip=0; ip<Nsplit; ip++) {
+        uint Nstart = P->seedSearchStartLmax>0 && seedSearchStartLmax<splitR[1][ip] ? splitR[1][ip]/seedSearchStartLmax+1 : 1;
+        uint Lstart = splitR[1][ip]/Nstart;
+        uint iChainDir0=seedChains.size(); //chain of the 1st start in the forward direction
+        for (uint iDir=0; iDir<2; iDir++) {//loop over two directions
+            for (uint istart=0; istart<Nstart; istart++) {
+                SeedChain chain1;
+                chain1.ip=ip; chain1.iDir=iDir; chain1.istart=istart; chain1.Lstart=Lstart;
+                chain1.Lmapped=0; chain1.seedN=0; chain1.chainDir=(uint) -1;
+                chain1.fixedLength=false;
+                if (iDir==1 && istart==0) {//check if the 1st piece in reverse direction does not need to be remapped
+                    seedChains[iChainDir0].chainDir=seedChains.size();
+                };
+                seedChains.push_back(chain1);
+
+                if (P->seedSearchLmax>0) {//search fixed length. Not very efficient, need to improve
+                    chain1.fixedLength=true;
+                    seedChains.push_back(chain1);
+                };
+            };
+        };
+    };
+
+    for (uint ic=0; ic<seedChains.size(); ic++) {//start all chains, except those waiting for the opposite direction
+        if (seedChains[ic].iDir==1 && seedChains[ic].istart==0 && !seedChains[ic].fixedLength) continue;
+        seedChainNext(ic);
+    };
+    seedActive.swap(seedActiveNext);
+
+    while (seedActive.size()>0) {//lockstep: one genome comparison for each active search
+        for (uint ia=0; ia<seedActive.size(); ia++) {
+            Seed &seed1=seeds[seedActive[ia]];
+            for (uint is=seed1.searchStart; is<seed1.searchStart+seed1.searchN; is++) {
+                if (!saSearch[is].searchDone) SA.prefetch(saSearch[is].iProbe);
+            };
+        };
+        for (uint ia=0; ia<seedActive.size(); ia++) {
+            Seed &seed1=seeds[seedActive[ia]];
+            for (uint is=seed1.searchStart; is<seed1.searchStart+seed1.searchN; is++) {
+                if (!saSearch[is].searchDone) {
+                    saSearchSAstr[is]=SA[saSearch[is].iProbe];
+                    saSearch[is].prefetchGenome(saSearchSAstr[is]);
+                };
+            };
+        };
+        seedActiveNext.clear();
+        for (uint ia=0; ia<seedActive.size(); ia++) {
+            uint iSeed=seedActive[ia];
+            bool seedDone=true;
+            for (uint is=seeds[iSeed].searchStart; is<seeds[iSeed].searchStart+seeds[iSeed].searchN; is++) {
+                if (!saSearch[is].searchDone) {
+                    saSearch[is].probe(saSearchSAstr[is]);
+                    seedDone = seedDone && saSearch[is].searchDone;
+                };
+            };
+            if (seedDone) {//the next seed of this chain can start
+                seedFinish(iSeed);
+                seedChainNext(seeds[iSeed].iChain);
+            } else {
+                seedActiveNext.push_back(iSeed);
+            };
+        };
+        seedActive.swap(seedActiveNext);
+    };
+
+    for (uint ic=0; ic<seedChains.size(); ic++) {//store the alignments of all seeds, in the sequential order
+        SeedChain &chain1=seedChains[ic];
+        uint iSeed=chain1.seedFirst;
+        for (uint iN=0; iN<chain1.seedN; iN++) {
+            Seed &seed1=seeds[iSeed];
+            bool dirR = seed1.iDir==0;
+            for (uint iDist=0; iDist<seed1.searchN; iDist++) {//store the distances with the largest maxL
+                SuffixArraySearch &search1=saSearch[seed1.searchStart+iDist];
+                if ( (search1.L+iDist) == seed1.L) {
+                    storeAligns(seed1.iDir, (dirR ? seed1.Shift+iDist : seed1.Shift-iDist), search1.Nrep, search1.L, search1.indStartEnd, splitR[2][chain1.ip]);
+                };
+            };
+            iSeed=seed1.seedNext;
+        };
+    };
+};
+
+void ReadAlign::seedChainNext(uint iChain) {
+    //start the next seed of the chain; seeds that do not need genome comparisons are finished immediately
+    while (true) {
+        SeedChain &chain1=seedChains[iChain];
+        uint ip=chain1.ip;
+        Seed seed1;
+        seed1.iChain=iChain;
+        seed1.iDir=chain1.iDir;
+        if (chain1.fixedLength) {
+            if (chain1.seedN>0) break;
+            seed1.Shift = chain1.iDir==0 ? ( splitR[0][ip] + chain1.istart*chain1.Lstart ) : \
+                           ( splitR[0][ip] + splitR[1][ip] - chain1.istart*chain1.Lstart-1); //choose Shift for forward or reverse
+            seed1.length = min(P->seedSearchLmax, chain1.iDir==0 ? (splitR[0][ip] + splitR[1][ip]-seed1.Shift):(seed1.Shift+1) );
+        } else {
+            if ( chain1.istart*chain1.Lstart + chain1.Lmapped + P->minLmap >= splitR[1][ip] ) {//map until unmapped portion is <=minLmap
+                if (chain1.seedN==0 && chain1.chainDir!=(uint) -1) seedChainNext(chain1.chainDir); //nothing mapped in this direction
+                break;
+            };
+            seed1.Shift = chain1.iDir==0 ? ( splitR[0][ip] + chain1.istart*chain1.Lstart + chain1.Lmapped ) : \
+                       ( splitR[0][ip] + splitR[1][ip] - chain1.istart*chain1.Lstart-1-chain1.Lmapped); //choose Shift for forward or reverse
+            seed1.length=splitR[1][ip] - chain1.Lmapped - chain1.istart*chain1.Lstart;
+        };
+
+        uint iSeed=seeds.size();
+        if (chain1.seedN==0) {
+            chain1.seedFirst=iSeed;
+        } else {
+            seeds[chain1.seedLast].seedNext=iSeed;
+        };
+        chain1.seedLast=iSeed;
+        chain1.seedN++;
+
+        seed1.searchStart=saSearch.size();
+        uint searchN=min(seed1.length,P->genomeSAsparseD);
+        saSearch.resize(seed1.searchStart+searchN);
+        saSearchSAstr.resize(seed1.searchStart+searchN);
+        seed1.searchN=maxMappableLength2strands(seed1.Shift, seed1.length, seed1.iDir, seed1.searchStart);
+        seeds.push_back(seed1);
+
+        bool seedDone=true;
+        for (uint is=seed1.searchStart; is<seed1.searchStart+seed1.searchN; is++) {
+            seedDone = seedDone && saSearch[is].searchDone;
+        };
+        if (!seedDone) {
+            seedActiveNext.push_back(iSeed);
+            break;
+        };
+        seedFinish(iSeed);
+    };
+};
+
+void ReadAlign::seedFinish(uint iSeed) {
+    //max mappable length over all distances; advance the chain
+    Seed &seed1=seeds[iSeed];
+    seed1.L=0;
+    for (uint iDist=0; iDist<seed1.searchN; iDist++) {
+        uint L1=saSearch[seed1.searchStart+iDist].L+iDist;
+        if (L1 > seed1.L) seed1.L=L1;//this iDist is better
+    };
+
+    SeedChain &chain1=seedChains[seed1.iChain];
+    chain1.Lmapped+=seed1.L;
+    if (chain1.seedN==1 && chain1.chainDir!=(uint) -1 && !chain1.fixedLength) {//1st seed in the forward direction
+        if ( seed1.Shift+seed1.L != splitR[1][chain1.ip] ) {//this piece does not map full length and needs to be mapped from the opposite direction
+            seedChainNext(chain1.chainDir); //seeds can be reallocated here
+        };
+    };
+};
@@ -12,20 +12,22 @@
 
 void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint Lread) {
     
-       //zero-out winBin
-    memset(winBin[0],255,sizeof(winBin[0][0])*P->winBinN);
-    memset(winBin[1],255,sizeof(winBin[0][0])*P->winBinN);
+    for (uint iStr=0; iStr<2; iStr++) {//reset only the winBin ranges that were modified for the previous read
+        for (uint ii=0; ii<winBinDirty[iStr].size(); ii+=2) {
+            memset(winBin[iStr]+winBinDirty[iStr][ii],255,sizeof(winBin[0][0])*(winBinDirty[iStr][ii+1]-winBinDirty[iStr][ii]+1));
+        };
+        winBinDirty[iStr].clear();
+    };
+
+    uint saDecodedN=0; //the SA ranges of all pieces are decoded once, the two passes below read the SA values from saDecoded
+    for (uint iP=0; iP<nP; iP++) saDecodedN += PC[iP][PC_SAend]-PC[iP][PC_SAstart]+1;
+    if (saDecoded.size()<saDecodedN) saDecoded.resize(saDecodedN);
+    saDecodedN=0;
+    for (uint iP=0; iP<nP; iP++) {
+        SA.decodeRange(PC[iP][PC_SAstart], PC[iP][PC_SAend]-PC[iP][PC_SAstart]+1, saDecoded.data()+saDecodedN);
+        saDecodedN += PC[iP][PC_SAend]-PC[iP][PC_SAstart]+1;
+    };
 
-    
-//     for (uint iWin=0;iWin<nWall;iWin++) {//zero out winBin
-//         if (WC[iWin][WC_gStart]<=WC[iWin][WC_gEnd]) {//otherwise the window is dead
-//             memset(&(winBin[WC[iWin][WC_Str]][WC[iWin][WC_gStart]]),255,sizeof(winBin[0][0])*(WC[iWin][WC_gEnd]-WC[iWin][WC_gStart]+1));
-//         };
-// //         for (uint ii=C[iWin][WC_gStart]; ii<WC[iWin][WC_gEnd]; ii++) {
-// //             winBin[WC[WC_Str]
-// //         };
-//     };
-    
 //     //debug
 //     for (uint ii=0;ii<P->winBinN;ii++){
 //         if (winBin[0][ii]!=uintWinBinMax || winBin[1][ii]!=uintWinBinMax) {
@@ -39,7 +41,8 @@ void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint
     
     
     nW=0; //number of windows
-    for (uint iP=0; iP<nP; iP++) {//scan through all anchor pieces, create alignment windows
+    const uint* aSA=saDecoded.data(); //SA values of the piece iP, aSA[0] is SA[PC[iP][PC_SAstart]]
+    for (uint iP=0; iP<nP; aSA+=PC[iP][PC_SAend]-PC[iP][PC_SAstart]+1, iP++) {//scan through all anchor pieces, create alignment windows
 
 //          if (PC[iP][PC_Nrep]<=P->winAnchorMultimapNmax || PC[iP][PC_Length]>=readLength[PC[iP][PC_iFrag]] ) {//proceed if piece is an anchor, i.e. maps few times or is long enough
        if (PC[iP][PC_Nrep]<=P->winAnchorMultimapNmax ) {//proceed if piece is an anchor, i.e. maps few times
@@ -49,7 +52,7 @@ void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint
 
             for (uint iSA=PC[iP][PC_SAstart]; iSA<=PC[iP][PC_SAend]; iSA++) {//scan through all alignments of this piece
 
-                uint a1 = SA[iSA];
+                uint a1 = aSA[iSA-PC[iP][PC_SAstart]];
                 uint aStr = a1 >> P->GstrandBit;           
                 a1 &= P->GstrandMask; //remove strand bit
 
@@ -100,6 +103,7 @@ void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint
                 wb--;
                 winBin[ WC[iWin][WC_Str] ][ wb ]=(uintWinBin) iWin;
             };
+            if (wb<WC[iWin][WC_gStart]) winBinMarkDirty(WC[iWin][WC_Str], wb, WC[iWin][WC_gStart]-1);
             WC[iWin][WC_gStart] = wb;
             
             wb=WC[iWin][WC_gEnd];
@@ -107,10 +111,12 @@ void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint
                 wb++;
                 winBin[ WC[iWin][WC_Str] ][ wb ]=(uintWinBin) iWin;
             };
+            if (wb>WC[iWin][WC_gEnd]) winBinMarkDirty(WC[iWin][WC_Str], WC[iWin][WC_gEnd]+1, wb);
             WC[iWin][WC_gEnd] = wb;
             
           
         };
+        WA[iWin]=readArena.allocArray<uiWA>(P->seedPerWindowNmax);
         nWA[iWin]=0; //initialize nWA
         WALrec[iWin]=0; //initialize rec-length        
         WlastAnchor[iWin]=-1;
@@ -118,7 +124,8 @@ void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint
     
     nWall=nW;
     
-    for (uint iP=0; iP<nP; iP++) {//scan through all pieces/aligns, add them to alignment windows, create alignment coordinates
+    aSA=saDecoded.data();
+    for (uint iP=0; iP<nP; aSA+=PC[iP][PC_SAend]-PC[iP][PC_SAstart]+1, iP++) {//scan through all pieces/aligns, add them to alignment windows, create alignment coordinates
         uint aNrep=PC[iP][PC_Nrep];
         uint aFrag=PC[iP][PC_iFrag];  
         uint aLength=PC[iP][PC_Length];      
@@ -132,7 +139,7 @@ void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint
         
         for (uint iSA=PC[iP][PC_SAstart]; iSA<=PC[iP][PC_SAend]; iSA++) {//scan through all alignments
 
-            uint a1 = SA[iSA];
+            uint a1 = aSA[iSA-PC[iP][PC_SAstart]];
             uint aStr = a1 >> P->GstrandBit;           
             a1 &= P->GstrandMask; //remove strand bit
             uint aRstart=PC[iP][PC_rStart];
@@ -253,7 +260,7 @@ void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint
                     if (!( winLeft<trStart && winRight>trEnd && trA.Str==trStr) ) continue;
                     
                     intSWscore swScore=alignSmithWaterman(R[trA.roStr==0 ? 0:2],Lread,G+winLeft,winRight-winLeft,\
-                            (intSWscore) 200, (intSWscore) 200, (intSWscore) 200, (intSWscore) 1, swT, P->swHsize, trA);
+                            (intSWscore) 200, (intSWscore) 200, (intSWscore) 200, (intSWscore) 1, swBuf, trA);
                     
                     trA.maxScore = (uint) swScore;
                     
@@ -275,8 +282,8 @@ void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint
                     trA.rLength=1;
                     trA.nMatch=1;
 
-                    trAll[iW1]=trArrayPointer+trNtotal;
-                    *(trAll[iW1][0])=trA;
+                    trAll[iW1]=readArena.allocArray<Transcript*>(1);
+                    trAll[iW1][0]=Transcript::newCompact(trA, readArena);
                     
                     if (trAll[iW1][0]->maxScore > trBest->maxScore || (trAll[iW1][0]->maxScore == trBest->maxScore && trAll[iW1][0]->gLength < trBest->gLength ) ) {
                         trNext=trBest;
@@ -299,61 +306,61 @@ void ReadAlign::stitchPieces(char **R, char **Q, char *G, PackedArray& SA, uint
     };//if (P->swMode==1)
 #endif //#if defined PacBio
 
-#ifdef COMPILE_FOR_LONG_READS
-uint swWinCovMax=0;
-for (uint iW=0;iW<nW;iW++) {//check each window
-    swWinCov[iW]=0;
-    if (nWA[iW]>0) {
-        //select good windows by coverage
-        uint rLast=0;
-
-        for (uint ia=0; ia<nWA[iW]; ia++) {//calculate coverage from all aligns
-            uint L1=WA[iW][ia][WA_Length];
-            uint r1=WA[iW][ia][WA_rStart];
-
-            if (r1+L1>rLast+1) {
-                if (r1>rLast) {
-                    swWinCov[iW] += L1;
-                } else {
-                    swWinCov[iW] += r1+L1-(rLast+1);
-                };
-                rLast=r1+L1-1;
-            };                    
-        };//for (uint ia=0; ia<nWA[iW]; ia++)
-
-        if (swWinCov[iW]>swWinCovMax) swWinCovMax=swWinCov[iW];
-    };//if (nWA[iW]>0)
-};//for (uint iW=0;iW<nW;iW++)
-for (uint iW=0;iW<nW;iW++) {
-    if (swWinCov[iW]<swWinCovMax*10/10) {//remove windows that are not good enough
-        nWA[iW]=0;
-    } else {//merge pieces that are adjacent in R- and G-spaces
-        uint ia1=0;
-        for (uint ia=1; ia<nWA[iW]; ia++) {
-            if ( WA[iW][ia][WA_rStart] == (WA[iW][ia1][WA_rStart]+WA[iW][ia1][WA_Length]) \
-              && WA[iW][ia][WA_gStart] == (WA[iW][ia1][WA_gStart]+WA[iW][ia1][WA_Length]) \
-              && WA[iW][ia][WA_iFrag]  ==  WA[iW][ia1][WA_iFrag]     ) {//merge
+    if (P->alignLongReads==1) {//long reads: keep only the windows with the best coverage, merge the adjacent aligns
+        uint swWinCovMax=0;
+        for (uint iW=0;iW<nW;iW++) {//check each window
+            swWinCov[iW]=0;
+            if (nWA[iW]>0) {
+                //select good windows by coverage
+                uint rLast=0;
+
+                for (uint ia=0; ia<nWA[iW]; ia++) {//calculate coverage from all aligns
+                    uint L1=WA[iW][ia][WA_Length];
+                    uint r1=WA[iW][ia][WA_rStart];
+
+                    if (r1+L1>rLast+1) {
+                        if (r1>rLast) {
+                            swWinCov[iW] += L1;
+                        } else {
+                            swWinCov[iW] += r1+L1-(rLast+1);
+                        };
+                        rLast=r1+L1-1;
+                    };                    
+                };//for (uint ia=0; ia<nWA[iW]; ia++)
+
+                if (swWinCov[iW]>swWinCovMax) swWinCovMax=swWinCov[iW];
+            };//if (nWA[iW]>0)
+        };//for (uint iW=0;iW<nW;iW++)
+        for (uint iW=0;iW<nW;iW++) {
+            if (swWinCov[iW]<swWinCovMax*10/10) {//remove windows that are not good enough
+                nWA[iW]=0;
+            } else {//merge pieces that are adjacent in R- and G-spaces
+                uint ia1=0;
+                for (uint ia=1; ia<nWA[iW]; ia++) {
+                    if ( WA[iW][ia][WA_rStart] == (WA[iW][ia1][WA_rStart]+WA[iW][ia1][WA_Length]) \
+                      && WA[iW][ia][WA_gStart] == (WA[iW][ia1][WA_gStart]+WA[iW][ia1][WA_Length]) \
+                      && WA[iW][ia][WA_iFrag]  ==  WA[iW][ia1][WA_iFrag]     ) {//merge
                 
-                WA[iW][ia1][WA_Length] += WA[iW][ia][WA_Length];
-                WA[iW][ia1][WA_Anchor]=max(WA[iW][ia1][WA_Anchor],WA[iW][ia][WA_Anchor]);
-                //NOTE: I am not updating sjA and Nrep fields - this could cause trouble in some cases
+                        WA[iW][ia1][WA_Length] += WA[iW][ia][WA_Length];
+                        WA[iW][ia1][WA_Anchor]=max(WA[iW][ia1][WA_Anchor],WA[iW][ia][WA_Anchor]);
+                        //NOTE: I am not updating sjA and Nrep fields - this could cause trouble in some cases
                 
-            } else {//do not merge
-                ia1++;
-                if (ia1!=ia) {//move from ia to ia1
-                    for (uint ii=0; ii<WA_SIZE; ii++) {
-                        WA[iW][ia1][ii]=WA[iW][ia][ii];
+                    } else {//do not merge
+                        ia1++;
+                        if (ia1!=ia) {//move from ia to ia1
+                            for (uint ii=0; ii<WA_SIZE; ii++) {
+                                WA[iW][ia1][ii]=WA[iW][ia][ii];
+                            };
+                        };
                     };
                 };
+                nWA[iW]=ia1+1;
             };
         };
-        nWA[iW]=ia1+1;
-    };
-};
 
-//mapping time initialize
-std::time(&timeStart);
-#endif
+        //mapping time initialize
+        std::time(&timeStart);
+    };
     
     
     //generate transcript for each window, choose the best
@@ -389,22 +396,26 @@ std::time(&timeStart);
         trA.roStr = revertStrand ? 1-trA.Str : trA.Str; //original strand of the read
         trA.maxScore=0;
         
-        trAll[iW1]=trArrayPointer+trNtotal;
         if (trNtotal+P->alignTranscriptsPerWindowNmax > P->alignTranscriptsPerReadNmax) {
             P->inOut->logMain << "WARNING: not enough space allocated for transcript. Did not process all windows for read "<< readName+1 <<endl;
             P->inOut->logMain <<"   SOLUTION: increase alignTranscriptsPerReadNmax and re-run\n" << flush;
             break;
         };
+        trAll[iW1]=trWin; //the window is stitched into the full transcripts of trWin, and compacted into readArena below
+        for (uint ii=0;ii<=P->alignTranscriptsPerWindowNmax;ii++) trWin[ii]=trWinArray+ii;
         *(trAll[iW1][0])=trA;
         nWinTr[iW1]=0; //initialize number of transcripts per window
         
         
-    #ifdef COMPILE_FOR_LONG_READS
-        stitchWindowSeeds(iW, iW1, R[trA.roStr==0 ? 0:2], Q[trA.roStr], G);
-    #else
-        stitchWindowAligns(0, nWA[iW], 0, WAincl, 0, 0, trA, Lread, WA[iW], R[trA.roStr==0 ? 0:2], Q[trA.roStr], G, sigG, P, trAll[iW1], nWinTr+iW1, this);
-    #endif
-        trAll[iW1][0]->nextTrScore= nWinTr[iW1]==1 ? 0 : trAll[iW1][1]->maxScore;        
+        if (P->alignLongReads==1) {
+            stitchWindowSeeds(iW, iW1, R[trA.roStr==0 ? 0:2], Q[trA.roStr], G);
+        } else {
+            stitchWindowAligns(nWA[iW], WAincl, trA, Lread, WA[iW], R[trA.roStr==0 ? 0:2], Q[trA.roStr], G, P, trAll[iW1], nWinTr+iW1, this);
+        };
+        trAll[iW1][0]->nextTrScore= nWinTr[iW1]<=1 ? 0 : trAll[iW1][1]->maxScore;        
+
+        trAll[iW1]=readArena.allocArray<Transcript*>(max(nWinTr[iW1],(uint) 1));
+        for (uint ii=0;ii<max(nWinTr[iW1],(uint) 1);ii++) trAll[iW1][ii]=Transcript::newCompact(*trWin[ii], readArena); //only the recorded transcripts are kept for the read
         
         if (trAll[iW1][0]->maxScore > trBest->maxScore || (trAll[iW1][0]->maxScore == trBest->maxScore && trAll[iW1][0]->gLength < trBest->gLength ) ) {
             trNext=trBest;
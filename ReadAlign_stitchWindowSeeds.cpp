@@ -24,7 +24,7 @@ void ReadAlign::stitchWindowSeeds (uint iW, uint iWrec, char* R, char* Q, char*
                 score2=\
                     stitchAlignToTranscript(WA[iW][iS2][WA_rStart]+WA[iW][iS2][WA_Length]-1, WA[iW][iS2][WA_gStart]+WA[iW][iS2][WA_Length]-1,\
                                         WA[iW][iS1][WA_rStart], WA[iW][iS1][WA_gStart], WA[iW][iS1][WA_Length], WA[iW][iS1][WA_iFrag],  WA[iW][iS1][WA_sjA], \
-                                        P, R, Q, G, &trA1);  
+                                        P, R, Q, G, Gpacked, &trA1);  
                 if (score2>0 && score2+scoreSeedBest[iS2] > scoreSeedBest[iS1] ) {
                     scoreSeedBest[iS1]=score2+scoreSeedBest[iS2];
                     scoreSeedBestMM[iS1]=trA1.nMM;
@@ -33,7 +33,7 @@ void ReadAlign::stitchWindowSeeds (uint iW, uint iWrec, char* R, char* Q, char*
             } else {//extend to the left
                 score2=WA[iW][iS1][WA_Length];                
                 if ( WA[iW][iS1][WA_rStart]>0 \
-                     && extendAlign(R, Q, G, WA[iW][iS1][WA_rStart]-1, WA[iW][iS1][WA_gStart]-1, -1, -1, min(WA[iW][iS1][WA_rStart], WA[iW][iS1][WA_gStart] - P->chrStart[WC[iW][WC_Str]]), 100000, 0, P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trA1) ) {//if could extend
+                     && extendAlign(R, Q, G, Gpacked, WA[iW][iS1][WA_rStart]-1, WA[iW][iS1][WA_gStart]-1, -1, -1, min(WA[iW][iS1][WA_rStart], WA[iW][iS1][WA_gStart] - P->chrStart[WC[iW][WC_Str]]), 100000, 0, P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trA1) ) {//if could extend
                     score2 += trA1.maxScore;
                 };
                 if (score2 > scoreSeedBest[iS1] ) {
@@ -56,7 +56,7 @@ void ReadAlign::stitchWindowSeeds (uint iW, uint iWrec, char* R, char* Q, char*
        uint tR2=WA[iW][iS1][WA_rStart]+WA[iW][iS1][WA_Length];
        uint tG2=WA[iW][iS1][WA_gStart]+WA[iW][iS1][WA_Length];
        if ( tR2 < Lread-1 \
-            && extendAlign(R, Q, G, tR2, tG2, +1, +1, min(Lread-tR2,P->chrStart[WC[iW][WC_Str]+1]-tG2-1), 100000, scoreSeedBestMM[iS1], P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trA1) ) {//if could extend
+            && extendAlign(R, Q, G, Gpacked, tR2, tG2, +1, +1, min(Lread-tR2,P->chrStart[WC[iW][WC_Str]+1]-tG2-1), 100000, scoreSeedBestMM[iS1], P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trA1) ) {//if could extend
            scoreSeedBest[iS1]+=trA1.maxScore;
        };
        if (scoreSeedBest[iS1]>scoreBest) {//record new best transcript
@@ -96,7 +96,7 @@ void ReadAlign::stitchWindowSeeds (uint iW, uint iWrec, char* R, char* Q, char*
             uint iS1=seedChain[iSc], iS2=seedChain[iSc-1];
             int scoreStitch= stitchAlignToTranscript(WA[iW][iS1][WA_rStart]+WA[iW][iS1][WA_Length]-1, WA[iW][iS1][WA_gStart]+WA[iW][iS1][WA_Length]-1,\
                                         WA[iW][iS2][WA_rStart], WA[iW][iS2][WA_gStart], WA[iW][iS2][WA_Length], WA[iW][iS2][WA_iFrag],  WA[iW][iS2][WA_sjA], \
-                                        P, R, Q, G, &trA);  
+                                        P, R, Q, G, Gpacked, &trA);  
             if (scoreStitch>0) {
                 trA.maxScore+=scoreStitch;
             } else {
@@ -109,7 +109,7 @@ void ReadAlign::stitchWindowSeeds (uint iW, uint iWrec, char* R, char* Q, char*
             uint iS1=seedChain[seedN-1];
             trA1=*trInit;
             if ( trA.exons[0][EX_R]>0 \
-                 && extendAlign(R, Q, G, trA.exons[0][EX_R]-1, trA.exons[0][EX_G]-1, -1, -1, min(trA.exons[0][EX_R], trA.exons[0][EX_G] - P->chrStart[WC[iW][WC_Str]]), 100000, 0, P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trA1) ) {//if could extend
+                 && extendAlign(R, Q, G, Gpacked, trA.exons[0][EX_R]-1, trA.exons[0][EX_G]-1, -1, -1, min(trA.exons[0][EX_R], trA.exons[0][EX_G] - P->chrStart[WC[iW][WC_Str]]), 100000, 0, P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trA1) ) {//if could extend
 
                 trA.maxScore += trA1.maxScore + WA[iW][iS1][WA_Length];
                 trA.nMatch += trA1.nMatch + WA[iW][iS1][WA_Length]; //# of matches
@@ -129,7 +129,7 @@ void ReadAlign::stitchWindowSeeds (uint iW, uint iWrec, char* R, char* Q, char*
             uint tR2=WA[iW][iS1][WA_rStart]+WA[iW][iS1][WA_Length];
             uint tG2=WA[iW][iS1][WA_gStart]+WA[iW][iS1][WA_Length];
             if ( tR2 < Lread-1 \
-                && extendAlign(R, Q, G, tR2, tG2, +1, +1, min(Lread-tR2,P->chrStart[WC[iW][WC_Str]+1]-tG2-1), 100000, scoreSeedBestMM[iS1], P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trA1) ) {//if could extend
+                && extendAlign(R, Q, G, Gpacked, tR2, tG2, +1, +1, min(Lread-tR2,P->chrStart[WC[iW][WC_Str]+1]-tG2-1), 100000, scoreSeedBestMM[iS1], P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trA1) ) {//if could extend
                     trA.add(&trA1);                    
                     trA.exons[trA.nExons-1][EX_L] += trA1.extendL;//extend the length of the last exon
             };
@@ -0,0 +1,41 @@
+#include "ReadArena.h"
+
+ReadArena::ReadArena(uint firstChunkBytes) {
+    chunk.push_back(new char[firstChunkBytes]);
+    chunkBytes.push_back(firstChunkBytes);
+    iChunk=0;
+    used=0;
+};
+
+ReadArena::~ReadArena() {
+    for (uint ii=0; ii<chunk.size(); ii++) delete [] chunk[ii];
+};
+
+void ReadArena::reset() {//the chunks added for a large read are freed, the first chunk is kept
+    for (uint ii=1; ii<chunk.size(); ii++) delete [] chunk[ii];
+    chunk.resize(1);
+    chunkBytes.resize(1);
+    iChunk=0;
+    used=0;
+};
+
+void ReadArena::reserve(uint nBytes) {
+    reset();
+    if (nBytes>chunkBytes[0]) {
+        delete [] chunk[0];
+        chunk[0]=new char[nBytes];
+        chunkBytes[0]=nBytes;
+    };
+};
+
+void ReadArena::nextChunk(uint nBytes) {//move to the next chunk that can fit nBytes, allocate it if needed
+    for (iChunk++; iChunk<chunk.size(); iChunk++) {
+        if (nBytes<=chunkBytes[iChunk]) break;
+    };
+    if (iChunk==chunk.size()) {
+        uint nB=max(nBytes, (uint) READ_ARENA_CHUNK_BYTES);
+        chunk.push_back(new char[nB]);
+        chunkBytes.push_back(nB);
+    };
+    used=0;
+};
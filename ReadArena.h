@@ -0,0 +1,31 @@
+#ifndef DEF_ReadArena
+#define DEF_ReadArena
+
+#include "IncludeDefine.h"
+
+#define READ_ARENA_CHUNK_BYTES (1LLU<<20) //size of the chunks allocated when the arena grows
+
+class ReadArena {//bump-pointer allocator for the per-read alignment data: all allocations are released at once by reset()
+    public:
+        ReadArena(uint firstChunkBytes=READ_ARENA_CHUNK_BYTES); //the later chunks are allocated with READ_ARENA_CHUNK_BYTES
+        ~ReadArena();
+        void* alloc(uint nBytes); //nBytes rounded up to 8 bytes, the memory is not initialized
+        template <class T> T* allocArray(uint n) {return (T*) alloc(n*sizeof(T));};
+        void reset(); //release all allocations, only the first chunk is kept for the next read
+        void reserve(uint nBytes); //reset(), and enlarge the first chunk to nBytes if it is smaller
+    private:
+        vector <char*> chunk;
+        vector <uint> chunkBytes;
+        uint iChunk, used; //current chunk, bytes used in it
+        void nextChunk(uint nBytes);
+};
+
+inline void* ReadArena::alloc(uint nBytes) {
+    nBytes=(nBytes+7) & ~7LLU;
+    if (used+nBytes>chunkBytes[iChunk]) nextChunk(nBytes);
+    void *p=chunk[iChunk]+used;
+    used+=nBytes;
+    return p;
+};
+
+#endif
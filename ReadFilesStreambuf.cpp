@@ -0,0 +1,203 @@
+#include "ReadFilesStreambuf.h"
+#include "Parameters.h"
+#include "ErrorWarning.h"
+#include SAMTOOLS_BGZF_H
+
+#define READ_FILES_BLOCKS_N 64 //number of BGZF blocks decompressed in parallel
+#define READ_FILES_BUFFER_SIZE (READ_FILES_BLOCKS_N*BGZF_MAX_BLOCK_SIZE)
+
+ReadFilesStreambuf::ReadFilesStreambuf (const vector <string> &fileNamesIn, Parameters *Pin) : P(Pin), fileNames(fileNamesIn) {
+    for (uint ii=0; ii<fileNames.size(); ii++) {//check that all files can be opened
+        FILE *f1=fopen(fileNames.at(ii).c_str(),"rb");
+        if (f1==NULL) {
+            ostringstream errOut;
+            errOut <<"EXITING because of fatal input ERROR: could not open readFilesIn=" << fileNames.at(ii) <<"\n";
+            exitWithError(errOut.str(), std::cerr, P->inOut->logMain, EXIT_CODE_PARAMETER, *P);
+        };
+        fclose(f1);
+    };
+
+    outBuf=new char [READ_FILES_BUFFER_SIZE];
+    inBuf=new char [READ_FILES_BUFFER_SIZE];
+    headerBytes=0;
+    headerStart=0;
+    fileIn=NULL;
+    iFile=0;
+    setg(outBuf,outBuf,outBuf);
+};
+
+ReadFilesStreambuf::~ReadFilesStreambuf() {
+    if (fileIn!=NULL) {
+        fclose(fileIn);
+        if (fileFormat==formatGzip) inflateEnd(&zs);
+    };
+    delete [] outBuf;
+    delete [] inBuf;
+};
+
+ReadFilesStreambuf::int_type ReadFilesStreambuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+    while (true) {
+        if (fileIn==NULL && !openNextFile()) return traits_type::eof(); //no more files
+
+        uint outBytes=0;
+        switch (fileFormat) {
+            case formatPlain: outBytes=fillPlain(); break;
+            case formatGzip:  outBytes=fillGzip();  break;
+            case formatBGZF:  outBytes=fillBGZF();  break;
+        };
+
+        if (outBytes>0) {
+            setg(outBuf,outBuf,outBuf+outBytes);
+            return traits_type::to_int_type(*gptr());
+        };
+
+        //end of this file
+        fclose(fileIn);
+        fileIn=NULL;
+        if (fileFormat==formatGzip) inflateEnd(&zs);
+    };
+};
+
+bool ReadFilesStreambuf::openNextFile() {//open the next file, detect its format from the first bytes
+    if (iFile>=fileNames.size()) return false;
+
+    fileIn=fopen(fileNames.at(iFile).c_str(),"rb");
+    if (fileIn==NULL) fileError("could not open the file");
+    iFile++;
+
+    headerBytes=fread(header,1,READ_FILES_HEADER_SIZE,fileIn);
+    headerStart=0;
+
+    unsigned char *h=(unsigned char*) header;
+    if (headerBytes>=2 && h[0]==31 && h[1]==139) {//gzip
+        if (headerBytes==READ_FILES_HEADER_SIZE && (h[3]&4) && h[10]==6 && h[11]==0 && h[12]=='B' && h[13]=='C' && h[14]==2 && h[15]==0) {
+            fileFormat=formatBGZF;
+        } else {
+            fileFormat=formatGzip;
+            zs.zalloc=Z_NULL;
+            zs.zfree=Z_NULL;
+            zs.opaque=Z_NULL;
+            zs.next_in=Z_NULL;
+            zs.avail_in=0;
+            if (inflateInit2(&zs,15+16) != Z_OK) fileError("could not initialize zlib"); //15+16: gzip header
+            zsEnd=false;
+            zsTrailing=false;
+        };
+    } else {
+        fileFormat=formatPlain;
+    };
+
+    P->inOut->logMain << "Opened read file " << fileNames.at(iFile-1) << " ; format: " << (fileFormat==formatPlain ? "plain" : (fileFormat==formatGzip ? "gzip" : "BGZF")) <<"\n"<<flush;
+    return true;
+};
+
+uint ReadFilesStreambuf::readFile(char *dest, uint n) {//read from the file, starting with the bytes already loaded for format detection
+    uint n1=min(n,headerBytes-headerStart);
+    memcpy(dest,header+headerStart,n1);
+    headerStart+=n1;
+    if (n1<n) n1+=fread(dest+n1,1,n-n1,fileIn);
+    return n1;
+};
+
+uint ReadFilesStreambuf::fillPlain() {
+    return readFile(outBuf,READ_FILES_BUFFER_SIZE);
+};
+
+uint ReadFilesStreambuf::fillGzip() {//sequential inflate; multi-member files are handled by re-starting the stream at the end of each member
+    zs.next_out=(Bytef*) outBuf;
+    zs.avail_out=READ_FILES_BUFFER_SIZE;
+    while (zs.avail_out>0 && !zsTrailing) {
+        if (zs.avail_in==0) {
+            uint inBytes=readFile(inBuf,READ_FILES_BUFFER_SIZE);
+            if (inBytes==0) {//end of file
+                if (!zsEnd) fileError("unexpected end of the gzip file, the file may be truncated");
+                break;
+            };
+            zs.next_in=(Bytef*) inBuf;
+            zs.avail_in=inBytes;
+        };
+        if (zsEnd) {//next member, or trailing bytes that are not gzip
+            if (zs.avail_in<2) {//the gzip magic bytes may be split by the end of the buffer
+                memmove(inBuf,zs.next_in,zs.avail_in);
+                zs.next_in=(Bytef*) inBuf;
+                zs.avail_in+=readFile(inBuf+zs.avail_in,READ_FILES_BUFFER_SIZE-zs.avail_in);
+            };
+            if (zs.avail_in<2 || zs.next_in[0]!=31 || zs.next_in[1]!=139) {//as gzip -d, the trailing garbage is ignored with a warning
+                P->inOut->logMain << "WARNING: in readFilesIn=" << fileNames.at(iFile-1) << " : the bytes after the last gzip member are not gzip, they are ignored\n" <<flush;
+                zsTrailing=true;
+                break;
+            };
+            inflateReset(&zs);
+            zsEnd=false;
+        };
+        int zStatus=inflate(&zs,Z_NO_FLUSH);
+        if (zStatus==Z_STREAM_END) {
+            zsEnd=true;
+        } else if (zStatus!=Z_OK && zStatus!=Z_BUF_ERROR) {
+            fileError("could not decompress the gzip file, zlib error " + to_string((long long) zStatus));
+        };
+    };
+    return READ_FILES_BUFFER_SIZE-zs.avail_out;
+};
+
+uint ReadFilesStreambuf::fillBGZF() {//load a series of BGZF blocks, inflate them in parallel
+    uint blockInStart[READ_FILES_BLOCKS_N], blockInL[READ_FILES_BLOCKS_N], blockOutStart[READ_FILES_BLOCKS_N], blockOutL[READ_FILES_BLOCKS_N];
+    uint blockN=0, inBytes=0, outBytes=0;
+
+    while (blockN<READ_FILES_BLOCKS_N) {
+        unsigned char *h=(unsigned char*) (inBuf+inBytes);
+        uint hBytes=readFile(inBuf+inBytes,READ_FILES_HEADER_SIZE);
+        if (hBytes==0) break; //end of file
+        if (hBytes<READ_FILES_HEADER_SIZE || h[0]!=31 || h[1]!=139 || !(h[3]&4) || h[12]!='B' || h[13]!='C') {
+            fileError("corrupt or truncated BGZF block header");
+        };
+        uint blockL=(uint) (h[16] | (h[17]<<8)) + 1; //total block size
+        uint xlen=(uint) (h[10] | (h[11]<<8));
+        if (blockL < READ_FILES_HEADER_SIZE+8 || xlen!=6) fileError("unsupported BGZF block header");
+        if (blockL > BGZF_MAX_BLOCK_SIZE) fileError("corrupt BGZF block: the block size exceeds the BGZF maximum");
+
+        uint restL=blockL-READ_FILES_HEADER_SIZE;
+        if (readFile(inBuf+inBytes+READ_FILES_HEADER_SIZE,restL)!=restL) fileError("unexpected end of the BGZF file, the file may be truncated");
+
+        uint32 isize;
+        memcpy(&isize,inBuf+inBytes+blockL-4,sizeof(isize));
+        if (isize > BGZF_MAX_BLOCK_SIZE) fileError("corrupt BGZF block: the uncompressed size exceeds the BGZF maximum");
+        blockInStart[blockN]=inBytes+READ_FILES_HEADER_SIZE;
+        blockInL[blockN]=restL-8;
+        blockOutStart[blockN]=outBytes;
+        blockOutL[blockN]=isize;
+        inBytes+=blockL;
+        outBytes+=isize;
+        blockN++;
+    };
+
+    bool inflateError=false;
+    #pragma omp parallel for num_threads(P->runThreadN) schedule(static)
+    for (int ib=0; ib<(int) blockN; ib++) {
+        if (blockOutL[ib]==0) continue; //empty block, e.g. EOF marker
+        z_stream zs1;
+        zs1.zalloc=Z_NULL;
+        zs1.zfree=Z_NULL;
+        zs1.opaque=Z_NULL;
+        zs1.next_in=(Bytef*) (inBuf+blockInStart[ib]);
+        zs1.avail_in=blockInL[ib];
+        zs1.next_out=(Bytef*) (outBuf+blockOutStart[ib]);
+        zs1.avail_out=blockOutL[ib];
+        if (inflateInit2(&zs1,-15)!=Z_OK || inflate(&zs1,Z_FINISH)!=Z_STREAM_END || zs1.total_out!=blockOutL[ib]) {
+            inflateError=true;
+        };
+        inflateEnd(&zs1);
+    };
+    if (inflateError) fileError("could not decompress a BGZF block");
+
+    return outBytes;
+};
+
+void ReadFilesStreambuf::fileError(const string &errorText) {
+    ostringstream errOut;
+    errOut <<"EXITING because of fatal input ERROR in readFilesIn=" << fileNames.at(iFile>0 ? iFile-1 : 0) <<" : "<< errorText <<"\n";
+    errOut <<"SOLUTION: check the formatting of the read file. Compressed files have to be gzip or BGZF.\n";
+    exitWithError(errOut.str(), std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+};
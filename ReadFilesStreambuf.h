@@ -0,0 +1,44 @@
+#ifndef DEF_ReadFilesStreambuf
+#define DEF_ReadFilesStreambuf
+
+#include "IncludeDefine.h"
+#include <streambuf>
+#include <cstdio>
+#include <zlib.h>
+
+#define READ_FILES_HEADER_SIZE 18 //bytes read at the start of each file to detect compression
+
+class Parameters;
+
+class ReadFilesStreambuf : public std::streambuf {//input stream buffer for read files: plain, gzip or BGZF; several files are concatenated
+public:
+    ReadFilesStreambuf (const vector <string> &fileNamesIn, Parameters *Pin);
+    ~ReadFilesStreambuf();
+
+protected:
+    int_type underflow();
+
+private:
+    Parameters *P;
+    vector <string> fileNames;
+    uint iFile; //current file
+    FILE *fileIn;
+    enum {formatPlain, formatGzip, formatBGZF} fileFormat;
+
+    char *outBuf, *inBuf; //decompressed and compressed data
+    char header[READ_FILES_HEADER_SIZE]; //first bytes of the file
+    uint headerBytes, headerStart; //bytes in the header, bytes already consumed
+
+    z_stream zs; //gzip stream
+    bool zsEnd; //gzip stream reached the end of a member
+    bool zsTrailing; //the bytes after the last gzip member are not gzip, they are ignored
+
+    bool openNextFile();
+    uint readFile(char *dest, uint n);
+    uint fillPlain();
+    uint fillGzip();
+    uint fillBGZF();
+    void fileError(const string &errorText);
+};
+
+#endif
@@ -15,9 +15,16 @@
 #include "ErrorWarning.h"
 #include "sysRemoveDir.h"
 #include "BAMfunctions.h"
+#include "bamSortByCoordinate.h"
+#include "alignServer.h"
+#include "GenomeIndexFile.h"
+#include "genomeBenchmark.h"
+#include "AlignCache.h"
 
 int main(int argInN, char* argIn[]) {
    
+    if (alignClientMode(argInN, argIn)) return alignClient(argInN, argIn); //thin client, the parameters are parsed by the server
+
     time(&g_statsAll.timeStart);
    
     Parameters *P = new Parameters; //all parameters
@@ -32,13 +39,25 @@ int main(int argInN, char* argIn[]) {
         (void) sysRemoveDir (P->outFileTmp);        
         P->inOut->logMain << "DONE: Genome generation, EXITING\n" << flush;
         exit(0);
-    } else if (P->runMode!="alignReads") {
+    } else if (P->runMode=="genomeVerify") {
+        genomeIndexVerify(P);
+        P->inOut->logMain << "DONE: Genome index verification, EXITING\n" << flush;
+        exit(0);
+    } else if (P->runMode!="alignReads" && P->runMode!="alignServer" && P->runMode!="genomeBenchmark") {
         P->inOut->logMain << "EXITING because of INPUT ERROR: unknown value of input parameter runMode=" <<P->runMode<<endl<<flush;
         exit(1);
     };
     
     Genome mainGenome (P);
     mainGenome.genomeLoad();
+    if (P->runMode=="genomeBenchmark") {
+        genomeBenchmark(P, mainGenome);
+        P->inOut->logMain << "DONE: Genome benchmark, EXITING\n" << flush;
+        exit(0);
+    };
+    if (P->runMode=="alignServer") {//the genome stays loaded, each job is mapped in a forked process, with its own parameters
+        P=alignServer(P, mainGenome); //returns only in the job processes
+    };
     //calculate genome-related parameters
     P->winBinN = P->nGenome/(1LLU << P->winBinNbits)+1;
 
@@ -94,8 +113,9 @@ int main(int argInN, char* argIn[]) {
         
         if (!P->outBAMbool) {//
             *P->inOut->outSAM << samHeaderStream.str();
-        } else if (P->outBAMunsorted){
-            outBAMwriteHeader(P->inOut->outBAMfileUnsorted,samHeaderStream.str(),P->chrName,P->chrLength);
+        } else {
+            if (P->outBAMunsorted) outBAMwriteHeader(P->inOut->outBAMfileUnsorted,samHeaderStream.str(),P->chrName,P->chrLength);
+            if (P->outBAMcoord) outBAMwriteHeader(P->inOut->outBAMfileCoord,samHeaderStream.str(),P->chrName,P->chrLength);
         };
     };
     
@@ -114,16 +134,22 @@ int main(int argInN, char* argIn[]) {
     // P->inOut->logMain << "mlock value="<<mlockall(MCL_CURRENT|MCL_FUTURE) <<"\n"<<flush;
     
    
+    AlignCache *alignCache=NULL; //alignments of the duplicate reads, shared by all threads
+    if (P->alignDuplicatesCacheN>0 && P->chimSegmentMin==0) {//the chimeric alignments are recorded during the mapping, they cannot be reused
+        alignCache=new AlignCache(P->alignDuplicatesCacheN);
+        P->inOut->logMain << "Created the alignment cache of the duplicate reads with " << P->alignDuplicatesCacheN << " slots\n" <<flush;
+    };
+
     ReadAlignChunk *RAchunk[P->runThreadN];
     for (int ii=0;ii<P->runThreadN;ii++) {
         RAchunk[ii]=new ReadAlignChunk(P, mainGenome, ii);
         RAchunk[ii]->RA->iRead=0;
+        RAchunk[ii]->RA->alignCache=alignCache;
         RAchunk[ii]->iThread=ii;
     };
     
     if (P->runThreadN>1) {
         g_threadChunks.threadArray=new pthread_t[P->runThreadN];
-        pthread_mutex_init(&g_threadChunks.mutexInRead, NULL);
         pthread_mutex_init(&g_threadChunks.mutexOutSAM, NULL);
         pthread_mutex_init(&g_threadChunks.mutexOutUnmappedFastx, NULL);
         pthread_mutex_init(&g_threadChunks.mutexOutFilterBySJout, NULL);
@@ -132,12 +158,16 @@ int main(int argInN, char* argIn[]) {
     
     
     ///////////////////////////////////////////////////////////////////
+    g_statsAll.numaReadN.assign(mainGenome.numaNodeN,0);
     g_statsAll.progressReportHeader(P->inOut->logProgress);    
     time(&g_statsAll.timeStartMap);
     *P->inOut->logStdOut << timeMonthDayTime(g_statsAll.timeStartMap) << " ..... Started mapping\n" <<flush;
     
     g_statsAll.timeLastReport=g_statsAll.timeStartMap;
     
+    g_threadChunks.chunkInQueue=new ChunkInQueue(P);
+    g_threadChunks.chunkInQueue->startReading(); //start the input reads thread
+    
     for (int ithread=1;ithread<P->runThreadN;ithread++) {//spawn threads
         pthread_create(&g_threadChunks.threadArray[ithread], NULL, &g_threadChunks.threadRAprocessChunks, (void *) RAchunk[ithread]);
     };
@@ -152,11 +182,13 @@ int main(int argInN, char* argIn[]) {
                 exitWithError(errOut.str(),std::cerr, P->inOut->logMain, 1, *P);
         };
     };    
+    g_threadChunks.chunkInQueue->finishReading(); //all input reads were loaded
     
     if (P->outFilterBySJoutStage==1) {//completed stage 1, go to stage 2
         outputSJ(RAchunk,P);//collapse novel junctions
         
         P->outFilterBySJoutStage=2;
+        if (alignCache!=NULL) alignCache->clear(); //the alignments of the 2nd stage are filtered by the collapsed junctions
         
         for (int ithread=1;ithread<P->runThreadN;ithread++) {//spawn threads
             pthread_create(&g_threadChunks.threadArray[ithread], NULL, &g_threadChunks.threadRAprocessChunks, (void *) RAchunk[ithread]);
@@ -178,6 +210,10 @@ int main(int argInN, char* argIn[]) {
         RAchunk[0]->chunkFilesCat(P->inOut->outSAM, P->outFileTmp + "/Aligned.out.sam.chunk", g_threadChunks.chunkOutN);
     };    
     
+    if (P->outBAMcoord) {//sort BAM by coordinate
+        bamSortByCoordinate(RAchunk, P);
+    };
+
     //aggregate output (junctions, signal, etc)
     //collapse splice junctions from different threads/chunks, and output them
     outputSJ(RAchunk,P);
@@ -191,7 +227,7 @@ int main(int argInN, char* argIn[]) {
     P->inOut->logMain  << "ALL DONE!\n"<<flush;
     sysRemoveDir (P->outFileTmp);
 
-    mainGenome.~Genome(); //need explicit call because of the delete P->inOut below
+    mainGenome.genomeRelease(); //uses the log, has to be called before the delete P->inOut below
     
     delete P->inOut; //to close files
     delete P;
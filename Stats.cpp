@@ -6,6 +6,7 @@ void Stats::resetN() {//zero all counters
     mappedMismatchesN = 0; mappedInsN = 0; mappedDelN = 0; mappedInsL = 0; mappedDelL = 0; mappedBases = 0;  mappedPortion = 0;
     mappedReadsU = 0; mappedReadsM = 0;
     unmappedOther = 0; unmappedShort = 0; unmappedMismatch = 0; unmappedMulti = 0;
+    alignCacheHitN = 0; alignCacheMissN = 0; alignCacheMissTime = 0;
     splicesNsjdb=0;
     for (uint ii=0; ii<SJ_MOTIF_SIZE; ii++) {
         splicesN[ii]=0;
@@ -24,6 +25,7 @@ void Stats::addStats(Stats &S) {//add S to Stats
     mappedInsL += S.mappedInsL; mappedDelL += S.mappedDelL; mappedBases += S.mappedBases;  mappedPortion += S.mappedPortion;
     mappedReadsU += S.mappedReadsU; mappedReadsM += S.mappedReadsM;
     unmappedOther += S.unmappedOther; unmappedShort += S.unmappedShort; unmappedMismatch += S.unmappedMismatch; unmappedMulti += S.unmappedMulti;
+    alignCacheHitN += S.alignCacheHitN; alignCacheMissN += S.alignCacheMissN; alignCacheMissTime += S.alignCacheMissTime;
     
     splicesNsjdb += S.splicesNsjdb;
     for (uint ii=0; ii<SJ_MOTIF_SIZE; ii++) {
@@ -87,6 +89,13 @@ void Stats::progressReport(ofstream &progressStream) {
                 <<SETW2<< (readN>0 ? double(unmappedShort)/double(readN)*100 : 0)<<'%'\
                 <<SETW2<< (readN>0 ? double(unmappedOther)/double(readN)*100 : 0) <<'%'\
                 <<"\n"<<flush;
+        if (numaReadN.size()>0) {//speed of the threads on each NUMA node
+            progressStream <<setw(15)<< "NUMA nodes M/hr:";
+            for (uint ii=0; ii<numaReadN.size(); ii++) {
+                progressStream <<" "<< ii <<":"<< double(numaReadN[ii])/1e6/difftime(timeCurrent,timeStartMap)*3600;
+            };
+            progressStream <<"\n"<<flush;
+        };
         timeLastReport=timeCurrent;
         
     };
@@ -131,6 +140,13 @@ void Stats::reportFinal(ofstream &streamOut, Parameters *P) {
                <<setw(w1)<< "% of reads unmapped: too many mismatches |\t"     << (readN>0 ? double(unmappedMismatch)/double(readN)*100 : 0) <<'%' <<"\n" \
                <<setw(w1)<< "% of reads unmapped: too short |\t"               << (readN>0 ? double(unmappedShort)/double(readN)*100 : 0) <<'%' <<"\n" \
                <<setw(w1)<< "% of reads unmapped: other |\t"                   << (readN>0 ? double(unmappedOther)/double(readN)*100 :0) <<'%'<<"\n" <<flush;
+
+    if (alignCacheHitN+alignCacheMissN>0) {//the duplicate reads cache was used
+        streamOut  <<setw(w1)<< "DUPLICATE READS CACHE:\n" \
+                   <<setw(w1)<< "Reads aligned from the cache |\t"             << alignCacheHitN <<"\n" \
+                   <<setw(w1)<< "% of reads aligned from the cache |\t"        << double(alignCacheHitN)/double(alignCacheHitN+alignCacheMissN)*100 <<'%' <<"\n" \
+                   <<setw(w1)<< "Mapping time saved, thread-seconds |\t"       << (alignCacheMissN>0 ? alignCacheMissTime/alignCacheMissN*alignCacheHitN : 0) <<"\n" <<flush;
+    };
 };
 
 
@@ -21,7 +21,11 @@ class Stats {
         
         uint unmappedOther, unmappedShort, unmappedMismatch, unmappedMulti;
 
+        uint alignCacheHitN, alignCacheMissN; //reads with the alignments from the duplicate reads cache, reads mapped with the cache enabled
+        double alignCacheMissTime; //mapping time of the alignCacheMissN reads, seconds
+
         time_t timeStart, timeStartMap, timeLastReport, timeFinish;     
+        vector <uint> numaReadN; //number of reads mapped by the threads on each NUMA node
         
         Stats ();
         void resetN();
@@ -1,144 +1,225 @@
 #include "SuffixArraysFuns.h"
 #include "PackedArray.h"
+#include "GenomePacked.h"
+#include "ErrorWarning.h"
 
-inline uint medianUint2(uint a, uint b) {
-    // returns (a+b)/2 
-    return a/2 + b/2 + (a%2 + b%2)/2;
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+    #define COMPARE_SEQ_SIMD
+    #include <immintrin.h>
+#endif
+
+//matchLength* return the index of the first mismatch between s and g, or n if the first n bases are identical
+//sRev/gRev: the sequence is scanned backwards, i.e. s[-ii] instead of s[ii]
+
+template <bool sRev, bool gRev> static inline uint matchLengthScalar(const char* s, const char* g, uint n, uint ii) {
+    for (; ii<n; ii++) {
+        if ( (sRev ? s[-(int64)ii] : s[ii]) != (gRev ? g[-(int64)ii] : g[ii]) ) break;
+    };
+    return ii;
+};
+
+#ifdef COMPARE_SEQ_SIMD
+
+static inline __m128i reverseBytesSSE2(__m128i x) {
+    x=_mm_shuffle_epi32(x,_MM_SHUFFLE(0,1,2,3)); //reverse 32-bit words
+    x=_mm_shufflelo_epi16(x,_MM_SHUFFLE(2,3,0,1)); //swap 16-bit words inside 32-bit words
+    x=_mm_shufflehi_epi16(x,_MM_SHUFFLE(2,3,0,1));
+    return _mm_or_si128(_mm_slli_epi16(x,8),_mm_srli_epi16(x,8)); //swap bytes inside 16-bit words
+};
+
+template <bool sRev, bool gRev> static inline uint matchLengthSSE2(const char* s, const char* g, uint n) {
+    uint ii=0;
+    for (; ii+16<=n; ii+=16) {
+        __m128i vs=_mm_loadu_si128((const __m128i*) (sRev ? s-ii-15 : s+ii));
+        __m128i vg=_mm_loadu_si128((const __m128i*) (gRev ? g-ii-15 : g+ii));
+        if (sRev!=gRev) {//bring both sequences into the same order
+            if (sRev) {
+                vs=reverseBytesSSE2(vs);
+            } else {
+                vg=reverseBytesSSE2(vg);
+            };
+        };
+        uint32 mask=(~_mm_movemask_epi8(_mm_cmpeq_epi8(vs,vg))) & 0xFFFF;
+        if (mask!=0) {//the first mismatch is the lowest set bit, or the highest if both sequences are reversed
+            return ii + ( (sRev && gRev) ? __builtin_clz(mask)-16 : __builtin_ctz(mask) );
+        };
+    };
+    return matchLengthScalar<sRev,gRev>(s,g,n,ii);
+};
+
+__attribute__((target("avx2"))) static inline __m256i reverseBytesAVX2(__m256i x) {
+    const __m256i revMask=_mm256_setr_epi8(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0);
+    x=_mm256_shuffle_epi8(x,revMask); //reverse bytes inside 128-bit lanes
+    return _mm256_permute4x64_epi64(x,0x4E); //swap lanes
+};
+
+template <bool sRev, bool gRev> __attribute__((target("avx2"))) static uint matchLengthAVX2(const char* s, const char* g, uint n) {
+    uint ii=0;
+    for (; ii+32<=n; ii+=32) {
+        __m256i vs=_mm256_loadu_si256((const __m256i*) (sRev ? s-ii-31 : s+ii));
+        __m256i vg=_mm256_loadu_si256((const __m256i*) (gRev ? g-ii-31 : g+ii));
+        if (sRev!=gRev) {
+            if (sRev) {
+                vs=reverseBytesAVX2(vs);
+            } else {
+                vg=reverseBytesAVX2(vg);
+            };
+        };
+        uint32 mask=~((uint32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(vs,vg)));
+        if (mask!=0) {
+            return ii + ( (sRev && gRev) ? __builtin_clz(mask) : __builtin_ctz(mask) );
+        };
+    };
+    return matchLengthScalar<sRev,gRev>(s,g,n,ii);
+};
+
+static bool cpuSupportsAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
 };
+static const bool compareSeqAVX2=cpuSupportsAVX2(); //runtime dispatch, checked once
+
+#endif
+
+template <bool sRev, bool gRev> static inline uint matchLength(const char* s, const char* g, uint n) {
+#ifdef COMPARE_SEQ_SIMD
+    if (compareSeqAVX2) return matchLengthAVX2<sRev,gRev>(s,g,n);
+    return matchLengthSSE2<sRev,gRev>(s,g,n);
+#else
+    return matchLengthScalar<sRev,gRev>(s,g,n,0);
+#endif
+};
+
+//readPlanes32* return the bit planes of 32 read bases, as in the packed genome: low and high bits of the codes, and the mask of the bases that are not A,C,G,T
+//sRev: bit i is the base s[-i]
 
-uint compareSeqToGenome(char** s2, uint S, uint N, uint L, char* g, PackedArray& SA, uint iSA, bool dirR, bool& comparRes, Parameters* P) {
+#ifdef COMPARE_SEQ_SIMD
+
+template <bool sRev> static inline void readPlanes32SSE2(const char* s, uint32 &lo, uint32 &hi, uint32 &bad) {
+    __m128i v0=_mm_loadu_si128((const __m128i*) (sRev ? s-15 : s));
+    __m128i v1=_mm_loadu_si128((const __m128i*) (sRev ? s-31 : s+16));
+    if (sRev) {
+        v0=reverseBytesSSE2(v0);
+        v1=reverseBytesSSE2(v1);
+    };
+    const __m128i three=_mm_set1_epi8(3);
+    lo  = (uint32) _mm_movemask_epi8(_mm_slli_epi16(v0,7)) | ((uint32) _mm_movemask_epi8(_mm_slli_epi16(v1,7))<<16); //bit 0 of each byte to the sign bit
+    hi  = (uint32) _mm_movemask_epi8(_mm_slli_epi16(v0,6)) | ((uint32) _mm_movemask_epi8(_mm_slli_epi16(v1,6))<<16);
+    bad = (uint32) _mm_movemask_epi8(_mm_cmpgt_epi8(v0,three)) | ((uint32) _mm_movemask_epi8(_mm_cmpgt_epi8(v1,three))<<16);
+};
+
+template <bool sRev> __attribute__((target("avx2"))) static inline void readPlanes32AVX2(const char* s, uint32 &lo, uint32 &hi, uint32 &bad) {
+    __m256i v=_mm256_loadu_si256((const __m256i*) (sRev ? s-31 : s));
+    if (sRev) v=reverseBytesAVX2(v);
+    lo  = (uint32) _mm256_movemask_epi8(_mm256_slli_epi16(v,7));
+    hi  = (uint32) _mm256_movemask_epi8(_mm256_slli_epi16(v,6));
+    bad = (uint32) _mm256_movemask_epi8(_mm256_cmpgt_epi8(v,_mm256_set1_epi8(3)));
+};
+
+#endif
+
+template <bool sRev> static inline void readPlanes32(const char* s, uint32 &lo, uint32 &hi, uint32 &bad) {
+#ifdef COMPARE_SEQ_SIMD
+    if (compareSeqAVX2) {
+        readPlanes32AVX2<sRev>(s,lo,hi,bad);
+    } else {
+        readPlanes32SSE2<sRev>(s,lo,hi,bad);
+    };
+#else
+    readPlanesScalar(s,sRev,32,lo,hi,bad);
+#endif
+};
+
+template <bool sRev> static inline uint matchLengthPacked(const char* s, const uint64* Gp, int64 gPos, bool gRev, uint n) {
+    //as matchLength, for the packed genome: 32 bases are compared at once with XOR of the bit planes, the first mismatch is found with ctz
+    for (uint ii=0; ii<n; ii+=32) {
+        uint32 rLo, rHi, rBad, gLo, gHi, gMask;
+        uint n1=min(n-ii,(uint) 32);
+        if (n1==32) {
+            readPlanes32<sRev>(sRev ? s-ii : s+ii, rLo, rHi, rBad);
+        } else {//the bytes after the sequence may not be accessible
+            readPlanesScalar(sRev ? s-ii : s+ii, sRev, n1, rLo, rHi, rBad);
+        };
+        genomePackedLoad32(Gp, gRev ? gPos-ii : gPos+ii, gRev, gLo, gHi, gMask);
+        uint32 diff = (rLo^gLo) | (rHi^gHi) | rBad | gMask; //N never matches: the read N is 9, the genome N is 4
+        if (n1<32) diff &= (1U<<n1)-1;
+        if (diff!=0) return ii+__builtin_ctz(diff);
+    };
+    return n;
+};
+
+uint compareSeqToGenome(char** s2, uint S, uint N, uint L, char* g, const uint64* Gp, uint SAstr, bool dirR, bool& comparRes, Parameters* P) {
     // compare s to g, find the maximum identity length
     // s2[0] read sequence; s2[1] complementary sequence
     // S position to start search from in s2[0],s2[1]
     //dirR forward or reverse direction search on read sequence
+    //Gp: packed genome, used instead of g if not NULL
+    //SAstr: suffix array value of the genome locus
     
-    register int64 ii;
+    int64 ii;
     
-    uint SAstr=SA[iSA];
     bool dirG = (SAstr>>P->GstrandBit) == 0; //forward or reverse strand of the genome
     SAstr &= P->GstrandMask;
     
+    if (Gp!=NULL) {
+        char* s = s2[dirR==dirG ? 0 : 1] + (dirR ? S+L : S-L);
+        int64 gPos = dirG ? SAstr+L : P->nGenome-1-SAstr-L;
+        ii = dirR ? matchLengthPacked<false>(s,Gp,gPos,!dirG,N-L) : matchLengthPacked<true>(s,Gp,gPos,!dirG,N-L);
+        char s1 = dirR ? s[ii] : s[-ii];
+        char g1 = genomePackedBase(Gp, dirG ? gPos+ii : gPos-ii);
+        if (dirG) {
+            comparRes = s1>g1;
+        } else {
+            comparRes = !(s1>g1 || g1>3);
+        };
+        return ii+L;
+    };
+
     
     if (dirR && dirG) {//forward on read, forward on genome
         char* s  = s2[0] + S + L;
         g += SAstr + L;
-        for (ii=0;(uint) ii < N-L; ii++)
-            if (s[ii]!=g[ii]) break;
+        ii=matchLength<false,false>(s,g,N-L);
         if (s[ii]>g[ii]) {comparRes=true;} else {comparRes=false;};
         return ii+L;
     } else if (dirR && !dirG) {
         char* s  = s2[1] + S + L;
         g += P->nGenome-1-SAstr - L;
-        for (ii=0; (uint) ii < N-L; ii++)
-            if (s[ii]!=g[-ii]) break;
+        ii=matchLength<false,true>(s,g,N-L);
         if (s[ii]>g[-ii] || g[-ii]>3) {comparRes=false;} else {comparRes=true;};
         return ii+L;
     } else if (!dirR && dirG) {
         char* s  = s2[1] + S - L;
         g += SAstr + L;
-        for (ii=0; (uint) ii < N-L; ii++)
-            if (s[-ii]!=g[ii]) break;
+        ii=matchLength<true,false>(s,g,N-L);
         if (s[-ii]>g[ii]) {comparRes=true;} else {comparRes=false;};
         return ii+L;
     } else {//if (!dirR && !dirG)
         char* s  = s2[0] + S - L;
         g += P->nGenome-1-SAstr - L;  
-        for (ii=0; (uint) ii < N-L; ii++){
-            if (s[-ii]!=g[-ii]) break;
-        };
+        ii=matchLength<true,true>(s,g,N-L);
         if (s[-ii]>g[-ii] || g[-ii]>3) {comparRes=false;} else {comparRes=true;};
         return ii+L;
     };    
 };
 
-uint findMultRange(uint i3, uint L3, uint i1, uint L1, uint i1a, uint L1a, uint i1b, uint L1b, char** s, char* g, PackedArray& SA, bool dirR, uint S, Parameters* P) {
-    // given SA index i3 and identity length L3, return the index of the farthest element with the same length, starting from i1,L1 or i1a,L1a, or i1b,L1b
-    
-    bool comparRes;    
-    
-    if (L1<L3) { //search between i1 and i3
-        L1b=L1; i1b=i1; i1a=i3;
-    }
-    else { 
-        if (L1a<L1) {//search between i1a and i1b, else: search bewtween i1a and i1b
-            L1b=L1a; i1b=i1a; i1a=i1;
-        };
-    };
-    while ( (i1b+1<i1a)|(i1b>i1a+1) ) { //L1a is the target length, i1a...i1b is the initial range, i1c,L1c is the value in the middle
-        uint i1c=medianUint2(i1a,i1b);
-        //uint L1c=identityLength(&g[SA[i3]+L1b],&g[SA[i1c]+L1b],L3-L1b)+L1b;
-        uint L1c=compareSeqToGenome(s,S,L3,L1b,g,SA,i1c,dirR,comparRes, P);                    
-        if (L1c==L3) {
-            i1a=i1c;
-        }
-        else { //L1c<L3, move i1c
-            i1b=i1c;L1b=L1c;
-        };
-    };      
-    return i1a;
-};
-
-uint maxMappableLength(char** s, uint S, uint N, char* g, PackedArray& SA, uint i1, uint i2, bool dirR, uint& L, uint* indStartEnd, Parameters* P) {
-    // find minimum mappable length of sequence s to the genome g with suffix array SA; length(s)=N; [i1 i2] is 
-    // returns number of mappings (1=unique);range indStartEnd; min mapped length = L
-    // binary search in SA space
-    
-    bool comparRes;
-    
-    uint L1,L2,i3,L3,L1a,L1b,L2a,L2b,i1a,i1b,i2a,i2b;
-        
-    L1=compareSeqToGenome(s,S,N,L,g,SA,i1,dirR,comparRes, P);
-    L2=compareSeqToGenome(s,S,N,L,g,SA,i2,dirR,comparRes, P);    
-
-//     L1=identityLength(&s[L],&g[SA[i1]]);
-//     L2=identityLength(&s[L],&g[SA[i2]]);
-    L= min(L1,L2);
-    
-    L1a=L1;L1b=L1;i1a=i1;i1b=i1;
-    L2a=L2;L2b=L2;i2a=i2;i2b=i2;
-    
-    i3=i1;L3=L1; //in case i1+1>=i2 an not iteration of the loope below is ever made
-    while (i1+1<i2) {//main binary search loop
-        i3=medianUint2(i1,i2);
-        L3=compareSeqToGenome(s,S,N,L,g,SA,i3,dirR,comparRes, P);
-
-        if (L3==N) break; //found exact match, exit the binary search        
-        
-        if (comparRes) { //move 1 to 3
-            if (L3>L1) {
-               L1b=L1a; L1a=L1; i1b=i1a; i1a=i1;
-            };
-            i1=i3;L1=L3;
-        }
-        else {
-            if (L3>L2) { //move 2 to 3
-               L2b=L2a; L2a=L2; i2b=i2a; i2a=i2;
-            };            
-            i2=i3;L2=L3;
-        };    
-        L= min(L1,L2);
 
+uint genomeSAwordLength(Parameters* P) {
+    if (P->genomeSAlayout=="Packed") {
+        return P->GstrandBit+1;
+    } else if (P->genomeSAlayout=="40bit" && P->GstrandBit+1<=40) {
+        return 40;
+    } else if (P->genomeSAlayout=="64bit") {
+        return 64;
     };
-    
-    if (L3<N) {//choose longest alignment length between L1 and L2
-        if (L1>L2) {
-            i3=i1;L3=L1;
-        } else {
-            i3=i2;L3=L2;
-        };
+    ostringstream errOut;
+    if (P->genomeSAlayout=="40bit") {
+        errOut << "EXITING because of FATAL ERROR: the genome is too long for --genomeSAlayout 40bit, the SA values need " << P->GstrandBit+1 << " bits\n";
+        errOut << "SOLUTION: use --genomeSAlayout 64bit or Packed\n" <<flush;
+    } else {
+        errOut << "EXITING because of FATAL ERROR: unrecognized value of genomeSAlayout=" << P->genomeSAlayout <<"\n";
+        errOut << "SOLUTION: use one of the allowed values of --genomeSAlayout : Packed, 40bit or 64bit\n" <<flush;
     };
-    // now i3,L3 is the "best" alignment, i.e. longest length  
-    
-    // find the range of SA indices in which the identiyLength is the same
-    i1=findMultRange(i3,L3,i1,L1,i1a,L1a,i1b,L1b,s,g,SA,dirR,S, P);
-    i2=findMultRange(i3,L3,i2,L2,i2a,L2a,i2b,L2b,s,g,SA,dirR,S, P);
-
-    L=L3; //output
-    indStartEnd[0]=i1; 
-    indStartEnd[1]=i2;
-
-    return i2-i1+1;
+    exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_PARAMETER, *P);
+    return 0;
 };
-
-
-
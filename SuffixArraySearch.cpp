@@ -0,0 +1,195 @@
+#include "SuffixArraySearch.h"
+#include "SuffixArraysFuns.h"
+
+#define SA_LCP_SCAN_MAX 256 //max number of LCP values scanned on each side of the best suffix
+
+inline bool findMultRangeLCP(uint i3, uint L3, uint iStart, uint iEnd, uint8* SAlcp, uint& i1, uint& i2) {
+    // find the range of SA indices around i3 that share L3 bases with i3 using the LCP array, within [iStart iEnd]
+    // false if L3 is above the LCP cap, or the range is too long for the scan; i1,i2 are not changed in this case
+    if (L3>SA_LCP_MAX) return false;
+
+    uint i1c=i3, i2c=i3;
+    for (; i1c>iStart && SAlcp[i1c]>=L3; --i1c) {
+        if (i3-i1c>=SA_LCP_SCAN_MAX) return false;
+    };
+    for (; i2c<iEnd && SAlcp[i2c+1]>=L3; ++i2c) {
+        if (i2c-i3>=SA_LCP_SCAN_MAX) return false;
+    };
+    i1=i1c;
+    i2=i2c;
+    return true;
+};
+
+void SuffixArraySearch::init(char** sIn, char* gIn, uint64* GpIn, PackedArray* SAin, uint8* SAlcpIn, Parameters* Pin) {
+    s=sIn;
+    g=gIn;
+    Gp=GpIn;
+    SA=SAin;
+    SAlcp=SAlcpIn;
+    P=Pin;
+};
+
+void SuffixArraySearch::startRange(uint Sin, uint Nin, bool dirRin, uint i1in, uint i2in, uint Lin) {
+    // find maximum mappable length of sequence s to the genome g with suffix array SA; length(s)=N; [i1 i2] is the initial range
+    // output: number of mappings (1=unique), range indStartEnd, mapped length L
+    S=Sin; N=Nin; dirR=dirRin;
+    i1=i1in; i2=i2in; L=Lin;
+    iStart=i1; iEnd=i2;
+    searchDone=false;
+    state=stateStart1; //compare both ends of the range first
+    iProbe=i1;
+    probeN=N;
+    probeL=L;
+};
+
+void SuffixArraySearch::startUnique(uint Sin, uint Nin, bool dirRin, uint i1in, uint Lin) {
+    S=Sin; N=Nin; dirR=dirRin;
+    indStartEnd[0]=indStartEnd[1]=i1in;
+    Nrep=1;
+    searchDone=false;
+    state=stateUnique;
+    iProbe=i1in;
+    probeN=N;
+    probeL=Lin;
+};
+
+void SuffixArraySearch::startDone(uint i1in, uint i2in, uint Lin) {
+    indStartEnd[0]=i1in;
+    indStartEnd[1]=i2in;
+    Nrep=i2in-i1in+1;
+    L=Lin;
+    searchDone=true;
+};
+
+void SuffixArraySearch::prefetchGenome(uint SAstr) {
+    bool dirG = (SAstr>>P->GstrandBit) == 0;
+    SAstr &= P->GstrandMask;
+    int64 gPos = dirG ? SAstr+probeL : P->nGenome-1-SAstr-probeL;
+    if (Gp!=NULL) {
+        __builtin_prefetch( Gp+((gPos+GENOME_PACKED_PAD)>>6)*GENOME_PACKED_BLOCK_WORDS );
+    } else {
+        __builtin_prefetch( g+gPos );
+    };
+};
+
+void SuffixArraySearch::probe(uint SAstr) {
+    bool comparRes;
+    uint Lp=compareSeqToGenome(s,S,probeN,probeL,g,Gp,SAstr,dirR,comparRes,P);
+
+    switch (state) {
+        case stateStart1:
+            L1=Lp;
+            state=stateStart2;
+            iProbe=i2;
+            break;
+
+        case stateStart2:
+            L2=Lp;
+            L= min(L1,L2);
+            L1a=L1;L1b=L1;i1a=i1;i1b=i1;
+            L2a=L2;L2b=L2;i2a=i2;i2b=i2;
+            i3=i1;L3=L1; //in case i1+1>=i2 and no iteration of the binary search is ever made
+            binaryNext();
+            break;
+
+        case stateBinary:
+            L3=Lp;
+            if (L3==N) {//found exact match, exit the binary search
+                binaryFinish();
+                break;
+            };
+            if (comparRes) { //move 1 to 3
+                if (L3>L1) {
+                   L1b=L1a; L1a=L1; i1b=i1a; i1a=i1;
+                };
+                i1=i3;L1=L3;
+            } else {
+                if (L3>L2) { //move 2 to 3
+                   L2b=L2a; L2a=L2; i2b=i2a; i2a=i2;
+                };
+                i2=i3;L2=L3;
+            };
+            L= min(L1,L2);
+            binaryNext();
+            break;
+
+        case stateUnique:
+            L=Lp;
+            searchDone=true;
+            break;
+
+        case stateMultLeft:
+        case stateMultRight:
+            if (Lp==L3) {
+                iMa=iProbe;
+            } else { //Lp<L3, move the non-target end
+                iMb=iProbe; LMb=Lp;
+            };
+            multRangeNext();
+            break;
+    };
+};
+
+void SuffixArraySearch::binaryNext() {//main binary search loop
+    if (i1+1<i2) {
+        i3=medianUint2(i1,i2);
+        state=stateBinary;
+        iProbe=i3;
+        probeN=N;
+        probeL=L;
+    } else {
+        binaryFinish();
+    };
+};
+
+void SuffixArraySearch::binaryFinish() {
+    if (L3<N) {//choose longest alignment length between L1 and L2
+        if (L1>L2) {
+            i3=i1;L3=L1;
+        } else {
+            i3=i2;L3=L2;
+        };
+    };
+    // now i3,L3 is the "best" alignment, i.e. longest length
+
+    // find the range of SA indices in which the identiyLength is the same
+    L=L3;
+    if (SAlcp!=NULL && findMultRangeLCP(i3,L3,iStart,iEnd,SAlcp,i1,i2)) {
+        indStartEnd[0]=i1;
+        indStartEnd[1]=i2;
+        Nrep=i2-i1+1;
+        searchDone=true;
+    } else {//binary search in the genome if the LCP array cannot be used
+        state=stateMultLeft;
+        multRangeStart(i1,L1,i1a,L1a,i1b,L1b);
+    };
+};
+
+void SuffixArraySearch::multRangeStart(uint iX, uint LX, uint iXa, uint LXa, uint iXb, uint LXb) {
+    // find the farthest SA index with the same length L3 as i3, starting from iX,LX or iXa,LXa, or iXb,LXb
+    if (LX<L3) { //search between iX and i3
+        LMb=LX; iMb=iX; iMa=i3;
+    } else {
+        iMa=iXa; iMb=iXb; LMb=LXb;
+        if (LXa<LX) {//search between iXa and iX, else: search bewtween iXa and iXb
+            LMb=LXa; iMb=iXa; iMa=iX;
+        };
+    };
+    multRangeNext();
+};
+
+void SuffixArraySearch::multRangeNext() {
+    if ( (iMb+1<iMa)|(iMb>iMa+1) ) { //L3 is the target length, iMa...iMb is the range, compare in the middle
+        iProbe=medianUint2(iMa,iMb);
+        probeN=L3;
+        probeL=LMb;
+    } else if (state==stateMultLeft) {
+        indStartEnd[0]=iMa;
+        state=stateMultRight;
+        multRangeStart(i2,L2,i2a,L2a,i2b,L2b);
+    } else {
+        indStartEnd[1]=iMa;
+        Nrep=indStartEnd[1]-indStartEnd[0]+1;
+        searchDone=true;
+    };
+};
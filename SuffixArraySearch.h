@@ -0,0 +1,45 @@
+#ifndef DEF_SuffixArraySearch
+#define DEF_SuffixArraySearch
+
+#include "IncludeDefine.h"
+#include "Parameters.h"
+#include "PackedArray.h"
+#include "GenomePacked.h"
+
+class SuffixArraySearch {//binary search for the maximum mappable length of one sequence in the suffix array
+                         //the search advances one genome comparison at a time, so that the searches of many seeds can be interleaved
+    public:
+        uint Nrep, L, indStartEnd[2]; //output: number of loci, max mappable length, SA range of the loci
+        bool searchDone; //output is ready
+        uint iProbe; //SA index that has to be compared next
+
+        void init(char** sIn, char* gIn, uint64* GpIn, PackedArray* SAin, uint8* SAlcpIn, Parameters* Pin); //sequences and arrays, once per read
+        void startRange(uint S, uint N, bool dirR, uint i1, uint i2, uint Lin); //search sequence s[S...S+N) in [i1 i2], the first Lin bases are known to match
+        void startUnique(uint S, uint N, bool dirR, uint i1, uint Lin); //only one SA index: find the match length
+        void startDone(uint i1, uint i2, uint Lin); //the result is known without genome comparisons
+        void prefetchGenome(uint SAstr); //SAstr=SA[iProbe]: prefetch the genome sequence for the next comparison
+        void probe(uint SAstr); //SAstr=SA[iProbe]: compare the sequence to the genome at SAstr, advance the search
+
+    private:
+        char **s, *g;
+        uint64 *Gp; //packed genome, NULL if not loaded
+        PackedArray *SA;
+        uint8 *SAlcp;
+        Parameters *P;
+
+        uint S, N; //sequence start and length
+        bool dirR; //direction of the search on the read
+        enum {stateStart1, stateStart2, stateBinary, stateUnique, stateMultLeft, stateMultRight} state;
+        uint probeN, probeL; //length and known matching length for the next comparison
+
+        uint L1,L2,i1,i2,i3,L3,L1a,L1b,L2a,L2b,i1a,i1b,i2a,i2b; //binary search: ends 1,2 of the range, middle 3; a,b: previous ends with shorter match lengths
+        uint iStart, iEnd; //initial search range
+        uint iMa, iMb, LMb; //search for the range of loci with the same match length: farthest index with L3, nearest index with shorter match, its match length
+
+        void binaryNext();
+        void binaryFinish();
+        void multRangeStart(uint iX, uint LX, uint iXa, uint LXa, uint iXb, uint LXb);
+        void multRangeNext();
+};
+
+#endif
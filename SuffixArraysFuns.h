@@ -5,10 +5,15 @@
 #include "Parameters.h"
 #include "PackedArray.h"
 
-uint medianUint2(uint, uint);
-uint compareSeqToGenome(char** s2, uint S, uint N, uint L, char* g, PackedArray& SA, uint iSA, bool dirR, bool& comparRes, Parameters* P); 
-uint findMultRange(uint i3, uint L3, uint i1, uint L1, uint i1a, uint L1a, uint i1b, uint L1b, char** s, char* g, PackedArray& SA, bool dirR, uint S, Parameters* P);
-uint maxMappableLength(char** s, uint S, uint N, char* g, PackedArray& SA, uint i1, uint i2, bool dirR, uint& L, uint* indStartEnd, Parameters* P);
+#define SA_LCP_MAX 255 //LCP values are capped to fit into one byte
+
+inline uint medianUint2(uint a, uint b) {
+    // returns (a+b)/2 
+    return a/2 + b/2 + (a%2 + b%2)/2;
+};
+
+uint genomeSAwordLength(Parameters* P); //bits per SA element for the --genomeSAlayout
+uint compareSeqToGenome(char** s2, uint S, uint N, uint L, char* g, const uint64* Gp, uint SAstr, bool dirR, bool& comparRes, Parameters* P); 
 void writePacked( char* a, uint jj, uint x);
 uint readPacked(char* a, uint jj);
 
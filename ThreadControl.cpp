@@ -3,5 +3,6 @@
 ThreadControl::ThreadControl() {
     chunkInN=0;
     chunkOutN=0;
+    chunkInQueue=NULL;
 //     chunkOutSAMposition=new uint [MAX_chunkOutSAMposition];
 };
\ No newline at end of file
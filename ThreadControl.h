@@ -2,6 +2,7 @@
 #define THREAD_CONTROL_DEF
 
 #include "ReadAlignChunk.h"
+#include "ChunkInQueue.h"
 #include <pthread.h>
 
 #define MAX_chunkOutSAMposition 100000
@@ -9,10 +10,12 @@
 class ThreadControl {
 public:
     pthread_t *threadArray;
-    pthread_mutex_t mutexInRead, mutexOutSAM, mutexOutChimSAM, mutexOutChimJunction, mutexOutUnmappedFastx, mutexOutFilterBySJout, mutexStats;
+    pthread_mutex_t mutexOutSAM, mutexOutChimSAM, mutexOutChimJunction, mutexOutUnmappedFastx, mutexOutFilterBySJout, mutexStats;
     
     uint chunkInN,chunkOutN;
     
+    ChunkInQueue *chunkInQueue; //input reads chunks loaded by the reader thread
+    
     ThreadControl();
     
     static void* threadRAprocessChunks(void *RAchunk) {
@@ -1,9 +1,153 @@
 #include "Transcript.h"
+#include <new>
+#include <pthread.h>
+
+uint Transcript::nExonsMax=MAX_N_EXONS;
+
+//the exon arrays of all Transcripts have the same size, the blocks are kept in per-thread free lists:
+//a block is taken from the list of the thread that creates the Transcript, and returned to the list of the thread that deletes it.
+//The list of an exiting thread is moved to the shared list, which is used by the other threads before allocating new blocks.
+//The lists record the capacity of their blocks: if nExonsMax changes, the blocks of the previous capacity are not reused
+#define TRANSCRIPT_BLOCKS_CHUNK 64 //blocks allocated at once when the free list is empty
+static __thread char *exonsBlocksFree=NULL;
+static __thread uint exonsBlocksFreeCap=0; //capacity of the blocks in the list of this thread, 0: the list is not initialized
+
+static char *exonsBlocksShared=NULL; //blocks of the exited threads
+static uint exonsBlocksSharedCap=0;
+static pthread_mutex_t exonsBlocksSharedMutex=PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t exonsBlocksKey; //its destructor is called at the exit of each thread that used the list
+static pthread_once_t exonsBlocksKeyOnce=PTHREAD_ONCE_INIT;
+
+static void exonsBlocksThreadExit(void*) {//move the list of the exiting thread to the shared list
+    if (exonsBlocksFree==NULL) return;
+    char *tail=exonsBlocksFree;
+    while (*((char**) tail)!=NULL) tail=*((char**) tail);
+    pthread_mutex_lock(&exonsBlocksSharedMutex);
+    if (exonsBlocksSharedCap!=exonsBlocksFreeCap) {//the shared blocks have the previous capacity
+        exonsBlocksShared=NULL;
+        exonsBlocksSharedCap=exonsBlocksFreeCap;
+    };
+    *((char**) tail)=exonsBlocksShared;
+    exonsBlocksShared=exonsBlocksFree;
+    pthread_mutex_unlock(&exonsBlocksSharedMutex);
+    exonsBlocksFree=NULL;
+};
+
+static void exonsBlocksKeyCreate() {
+    pthread_key_create(&exonsBlocksKey, exonsBlocksThreadExit);
+};
+
+static void exonsBlocksCheckCap() {//initialize the list of this thread, or drop it if nExonsMax has changed
+    if (exonsBlocksFreeCap==Transcript::nExonsMax) return;
+    if (exonsBlocksFreeCap==0) {
+        pthread_once(&exonsBlocksKeyOnce, exonsBlocksKeyCreate);
+        pthread_setspecific(exonsBlocksKey, (void*) &exonsBlocksFreeCap); //non-NULL value: the destructor is called at the thread exit
+    };
+    exonsBlocksFree=NULL;
+    exonsBlocksFreeCap=Transcript::nExonsMax;
+};
+
+static uint exonsBlockBytes(uint nCap) {//exons, shiftSJ, canonSJ, sjAnnot, sjStr
+    return ( nCap*((EX_SIZE+2)*sizeof(uint)+sizeof(int)+2*sizeof(uint8)) + sizeof(uint)-1 ) / sizeof(uint) * sizeof(uint);
+};
+
+void Transcript::exonsPoint(char *block, uint nCap) {
+    nExonsCap=nCap;
+    exons=(uint (*)[EX_SIZE]) block;
+    shiftSJ=(uint (*)[2]) (exons+nCap);
+    canonSJ=(int*) (shiftSJ+nCap);
+    sjAnnot=(uint8*) (canonSJ+nCap);
+    sjStr=sjAnnot+nCap;
+};
+
+void Transcript::exonsBlockGet() {
+    exonsBlocksCheckCap();
+    if (exonsBlocksFree==NULL) {//take the blocks of the exited threads
+        pthread_mutex_lock(&exonsBlocksSharedMutex);
+        if (exonsBlocksSharedCap==nExonsMax) {
+            exonsBlocksFree=exonsBlocksShared;
+            exonsBlocksShared=NULL;
+        };
+        pthread_mutex_unlock(&exonsBlocksSharedMutex);
+    };
+    if (exonsBlocksFree==NULL) {
+        uint blockBytes=exonsBlockBytes(nExonsMax);
+        char *chunk=new char[blockBytes*TRANSCRIPT_BLOCKS_CHUNK];
+        for (uint ii=0; ii<TRANSCRIPT_BLOCKS_CHUNK; ii++) {
+            *((char**) (chunk+ii*blockBytes))=exonsBlocksFree;
+            exonsBlocksFree=chunk+ii*blockBytes;
+        };
+    };
+    exonsBlock=exonsBlocksFree;
+    exonsBlocksFree=*((char**) exonsBlock);
+    exonsPoint(exonsBlock, nExonsMax);
+};
 
 Transcript::Transcript() {
+    exonsBlockGet();
     reset();
 };
 
+Transcript::Transcript(const Transcript &trIn) {
+    exonsBlockGet();
+    *this=trIn;
+};
+
+Transcript::Transcript(const Transcript &trIn, ReadArena &arena) {
+    exonsBlock=NULL;
+    uint nCap=min(trIn.nExons, nExonsMax);
+    exonsPoint((char*) arena.alloc(exonsBlockBytes(nCap)), nCap);
+    *this=trIn;
+};
+
+uint Transcript::compactBytes(const Transcript &trIn) {//the same rounding as in ReadArena::alloc
+    return ( (sizeof(Transcript)+7) & ~7LLU ) + ( (exonsBlockBytes(min(trIn.nExons, nExonsMax))+7) & ~7LLU );
+};
+
+Transcript* Transcript::newCompact(const Transcript &trIn, ReadArena &arena) {//the arena memory is released without calling the destructor
+    return new (arena.alloc(sizeof(Transcript))) Transcript(trIn, arena);
+};
+
+Transcript::~Transcript() {
+    if (exonsBlock==NULL) return;
+    exonsBlocksCheckCap();
+    if (nExonsCap!=exonsBlocksFreeCap) return; //the block has the previous capacity, it is not reused
+    *((char**) exonsBlock)=exonsBlocksFree;
+    exonsBlocksFree=exonsBlock;
+};
+
+Transcript& Transcript::operator= (const Transcript &trIn) {
+    if (this==&trIn) return *this;
+
+    uint nEx=min(trIn.nExons+1, min(trIn.nExonsCap, nExonsCap)); //the exon after the last one may be already started
+    memcpy(exons, trIn.exons, nEx*sizeof(exons[0]));
+    memcpy(shiftSJ, trIn.shiftSJ, nEx*sizeof(shiftSJ[0]));
+    memcpy(canonSJ, trIn.canonSJ, nEx*sizeof(canonSJ[0]));
+    memcpy(sjAnnot, trIn.sjAnnot, nEx*sizeof(sjAnnot[0]));
+    memcpy(sjStr, trIn.sjStr, nEx*sizeof(sjStr[0]));
+
+    for (uint ii=0; ii<3; ii++) intronMotifs[ii]=trIn.intronMotifs[ii];
+    sjMotifStrand=trIn.sjMotifStrand;
+    nExons=trIn.nExons;
+    Lread=trIn.Lread; readLengthPairOriginal=trIn.readLengthPairOriginal;
+    iRead=trIn.iRead;
+    iFrag=trIn.iFrag;
+    rStart=trIn.rStart; roStart=trIn.roStart; rLength=trIn.rLength; gStart=trIn.gStart; gLength=trIn.gLength; cStart=trIn.cStart;
+    Chr=trIn.Chr; Str=trIn.Str; roStr=trIn.roStr;
+    primaryFlag=trIn.primaryFlag;
+    nWAmax=trIn.nWAmax;
+    nMatch=trIn.nMatch;
+    nMM=trIn.nMM;
+    mappedLength=trIn.mappedLength;
+    extendL=trIn.extendL;
+    maxScore=trIn.maxScore;
+    nextTrScore=trIn.nextTrScore;
+    nGap=trIn.nGap; lGap=trIn.lGap;
+    nDel=trIn.nDel; nIns=trIn.nIns; lDel=trIn.lDel; lIns=trIn.lIns;
+    nUnique=trIn.nUnique; nAnchor=trIn.nAnchor;
+    return *this;
+};
+
 void Transcript::reset() {
     extendL=0;
 
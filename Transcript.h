@@ -3,16 +3,18 @@
 
 #include "IncludeDefine.h"
 #include "Parameters.h"
+#include "ReadArena.h"
 
 class Transcript {
     public:
         //uint rMM[DEF_readSeqLengthMax]; //read-space MM coordinates. TODO: remove? reduce the size, do not save the whole array
 //         uint gMap[DEF_readSeqLengthMax]; //map read bases to genome. TODO: allocate with smaller size
-        uint exons[MAX_N_EXONS][EX_SIZE]; //coordinates of all exons: r-start, g-start, length
-        uint shiftSJ[MAX_N_EXONS][2]; //shift of the SJ coordinates due to genomic micro-repeats
-        int canonSJ[MAX_N_EXONS]; //canonicity of each junction
-        uint8 sjAnnot[MAX_N_EXONS]; //anotated or not
-        uint8 sjStr[MAX_N_EXONS]; //anotated or not
+        static uint nExonsMax; //capacity of the exon arrays, set from --limitAlignExonsN before any Transcript is created
+        uint (*exons)[EX_SIZE]; //coordinates of all exons: r-start, g-start, length
+        uint (*shiftSJ)[2]; //shift of the SJ coordinates due to genomic micro-repeats
+        int *canonSJ; //canonicity of each junction
+        uint8 *sjAnnot; //anotated or not
+        uint8 *sjStr; //anotated or not
         
         uint intronMotifs[3];
         uint8 sjMotifStrand;
@@ -51,10 +53,21 @@ class Transcript {
         uint nUnique, nAnchor; //number of unique pieces in the alignment, number of anchor pieces in the alignment   
         
         Transcript(); //resets to 0
+        Transcript(const Transcript &trIn);
+        Transcript& operator= (const Transcript &trIn); //copies the exon arrays up to nExons
+        ~Transcript();
         void reset(); //reset to 0
         void resetMapG(); // reset map to 0
         void resetMapG(uint); // reset map to 0 for Lread bases
         void add(Transcript*); // add
+        static Transcript* newCompact(const Transcript &trIn, ReadArena &arena); //copy of trIn in the arena, with the exon arrays of trIn.nExons records
+        static uint compactBytes(const Transcript &trIn); //arena bytes used by newCompact(trIn)
+    private:
+        char *exonsBlock; //exon arrays, from the per-thread free list; NULL for the compact transcripts
+        uint nExonsCap; //capacity of the exon arrays
+        void exonsPoint(char *block, uint nCap);
+        void exonsBlockGet();
+        Transcript(const Transcript &trIn, ReadArena &arena);
 };
 
 #endif
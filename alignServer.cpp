@@ -0,0 +1,355 @@
+#include "alignServer.h"
+#include "ErrorWarning.h"
+#include "GlobalVariables.h"
+#include "TimeFunctions.h"
+#include <map>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+//protocol: the client sends the number of arguments, then its working directory and the job command line arguments, each as the length and the bytes.
+//The server sends back records of 1 byte type, 4 bytes length and the data: chunks of the standard output and error of the job,
+//and the final record with the exit code of the job. All numbers are 32-bit, in the byte order of the host.
+#define SERVER_RECORD_OUTPUT 1
+#define SERVER_RECORD_EXIT 2
+#define SERVER_JOB_ARGS_MAX 100000 //sanity limits for the job description
+#define SERVER_JOB_ARG_LENGTH_MAX (1LLU<<24)
+
+struct ServerJob {//job running in a forked process
+    uint jobID;
+    int connFD; //connection to the client
+};
+
+static int serverChildPipe[2]; //written by the SIGCHLD handler to wake up the server loop
+
+static void serverChildSignal(int) {
+    int errnoSave=errno;
+    char c=0;
+    if (write(serverChildPipe[1],&c,1)<0) {};
+    errno=errnoSave;
+};
+
+static bool sendAll(int fd, const char* buf, uint n) {
+    while (n>0) {
+        ssize_t n1=send(fd, buf, n, MSG_NOSIGNAL);
+        if (n1<=0) return false;
+        buf+=n1;
+        n-=n1;
+    };
+    return true;
+};
+
+static bool recvAll(int fd, char* buf, uint n) {
+    while (n>0) {
+        ssize_t n1=read(fd, buf, n);
+        if (n1<0 && errno==EINTR) continue;
+        if (n1<=0) return false;
+        buf+=n1;
+        n-=n1;
+    };
+    return true;
+};
+
+static bool sendRecord(int fd, char recType, const char* buf, uint32 n) {
+    char header[5];
+    header[0]=recType;
+    memcpy(header+1, &n, sizeof(n));
+    return sendAll(fd, header, sizeof(header)) && sendAll(fd, buf, n);
+};
+
+static bool sendExitRecord(int fd, int exitCode) {
+    int32_t code1=exitCode;
+    return sendRecord(fd, SERVER_RECORD_EXIT, (char*) &code1, sizeof(code1));
+};
+
+static bool socketAddress(const string &socketPath, struct sockaddr_un &addr) {
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family=AF_UNIX;
+    if (socketPath.size()>=sizeof(addr.sun_path)) return false;
+    strcpy(addr.sun_path, socketPath.c_str());
+    return true;
+};
+
+static bool serverPeerAllowed(int connFD) {//the jobs are accepted only from the user of the server
+    struct ucred peerCred;
+    socklen_t credL=sizeof(peerCred);
+    if (getsockopt(connFD, SOL_SOCKET, SO_PEERCRED, &peerCred, &credL)!=0 || credL!=sizeof(peerCred)) return false;
+    return peerCred.uid==getuid();
+};
+
+static int serverSocketOpen(Parameters *P) {//listen on the server socket
+    struct sockaddr_un addr;
+    if (!socketAddress(P->serverSocket, addr)) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT ERROR: the path of the server socket is too long: " << P->serverSocket <<"\n";
+        errOut << "SOLUTION: use a path shorter than " << sizeof(addr.sun_path) << " characters for --serverSocket\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_PARAMETER, *P);
+    };
+
+    int listenFD=socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFD>=0 && connect(listenFD, (struct sockaddr*) &addr, sizeof(addr))==0) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: another alignment server is already listening on " << P->serverSocket <<"\n";
+        errOut << "SOLUTION: submit the jobs to the running server, or use a different --serverSocket\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_PARAMETER, *P);
+    };
+    if (listenFD>=0) close(listenFD);
+    unlink(P->serverSocket.c_str()); //socket file left by a server that was killed
+
+    listenFD=socket(AF_UNIX, SOCK_STREAM, 0);
+    mode_t umaskOld=umask(0177); //the socket is created with permissions 0600: only the user of the server can connect
+    bool bindOK=(listenFD>=0 && bind(listenFD, (struct sockaddr*) &addr, sizeof(addr))==0);
+    umask(umaskOld);
+    if (!bindOK || chmod(P->serverSocket.c_str(), S_IRUSR | S_IWUSR)!=0 || listen(listenFD, 64)!=0) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not listen on the server socket " << P->serverSocket << " : " << strerror(errno) <<"\n";
+        errOut << "SOLUTION: check that the directory of --serverSocket exists and you have permissions to write there\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+    };
+    return listenFD;
+};
+
+static void alignServerJobRelay(int connFD, int outFD, pid_t jobPid) {//send the job output to the client, then the exit code; exits with the exit code of the job
+    char buf[65536];
+    bool clientConnected=true; //if the client disconnected, the output is still read so that the job is not blocked
+    while (true) {
+        ssize_t n1=read(outFD, buf, sizeof(buf));
+        if (n1<0 && errno==EINTR) continue;
+        if (n1<=0) break; //all the copies of the job output were closed
+        if (clientConnected) clientConnected=sendRecord(connFD, SERVER_RECORD_OUTPUT, buf, (uint32) n1);
+    };
+    int status=0;
+    while (waitpid(jobPid, &status, 0)<0 && errno==EINTR) {};
+    int exitCode=(WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status));
+    if (clientConnected) sendExitRecord(connFD, exitCode);
+    exit(exitCode);
+};
+
+static Parameters* alignServerJob(Parameters *P, Genome &mainGenome, int connFD) {
+    //runs in the forked process: read the job description, parse the job parameters and attach them to the loaded genome
+    signal(SIGCHLD, SIG_DFL);
+    close(serverChildPipe[0]);
+    close(serverChildPipe[1]);
+
+    uint32 argN=0;
+    if (!recvAll(connFD, (char*) &argN, sizeof(argN)) || argN>SERVER_JOB_ARGS_MAX) exit(EXIT_CODE_INPUT_FILES); //the client disconnected or sent a corrupt job
+    vector <string> jobArgs(argN);
+    for (uint ii=0; ii<argN; ii++) {
+        uint32 argL=0;
+        if (!recvAll(connFD, (char*) &argL, sizeof(argL)) || argL>SERVER_JOB_ARG_LENGTH_MAX) exit(EXIT_CODE_INPUT_FILES);
+        jobArgs[ii].resize(argL);
+        if (argL>0 && !recvAll(connFD, &jobArgs[ii][0], argL)) exit(EXIT_CODE_INPUT_FILES);
+    };
+
+    //the job runs in a child process, this process relays its output to the client in framed chunks, and then the exit code
+    int outPipe[2];
+    pid_t jobPid=-1;
+    if (pipe(outPipe)!=0 || (jobPid=fork())<0) {
+        sendExitRecord(connFD, EXIT_CODE_RUNTIME);
+        exit(EXIT_CODE_RUNTIME);
+    };
+    if (jobPid>0) {
+        close(outPipe[1]);
+        alignServerJobRelay(connFD, outPipe[0], jobPid);
+    };
+    close(outPipe[0]);
+    dup2(outPipe[1], STDOUT_FILENO); //the job output goes to the relay
+    dup2(outPipe[1], STDERR_FILENO);
+    close(outPipe[1]);
+    close(connFD);
+
+    if (jobArgs.size()==0 || chdir(jobArgs[0].c_str())!=0) {
+        cerr << "EXITING because of FATAL ERROR: could not change to the working directory of the job: " << (jobArgs.size()>0 ? jobArgs[0] : "") <<"\n" <<flush;
+        exit(EXIT_CODE_PARAMETER);
+    };
+
+    vector <char*> argv;
+    string argv0="STAR", argGenomeDir="--genomeDir";
+    argv.push_back(&argv0[0]);
+    argv.push_back(&argGenomeDir[0]);
+    argv.push_back(&P->genomeDir[0]);
+    for (uint ii=1; ii<jobArgs.size(); ii++) argv.push_back(&jobArgs[ii][0]);
+    argv.push_back(NULL);
+
+    time(&g_statsAll.timeStart);
+    Parameters *Pjob = new Parameters;
+    Pjob->inputParameters(argv.size()-1, argv.data());
+
+    if (Pjob->runMode!="alignReads" || Pjob->genomeLoad!="NoSharedMemory") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT ERROR: --runMode " << Pjob->runMode << " --genomeLoad " << Pjob->genomeLoad << " cannot be used for the jobs of the alignment server\n";
+        errOut << "SOLUTION: do not specify --runMode and --genomeLoad for the job, the genome is loaded by the server\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, Pjob->inOut->logMain, EXIT_CODE_PARAMETER, *Pjob);
+    };
+    Pjob->genomeSAlcp=P->genomeSAlcp; //the genome arrays are defined by the server
+    Pjob->genomePacked=P->genomePacked;
+    Pjob->genomeNUMA=P->genomeNUMA;
+    Pjob->genomeHugePages=P->genomeHugePages;
+
+    *(Pjob->inOut->logStdOut) << timeMonthDayTime(g_statsAll.timeStart) << " ..... Started STAR job on the alignment server " << P->serverSocket << "\n" <<flush;
+    mainGenome.genomeJobAttach(Pjob);
+    return Pjob;
+};
+
+Parameters* alignServer(Parameters *P, Genome &mainGenome) {
+    int listenFD=serverSocketOpen(P);
+
+    if (pipe(serverChildPipe)!=0) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL ERROR: could not create a pipe: " << strerror(errno) <<"\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+    };
+    fcntl(serverChildPipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(serverChildPipe[1], F_SETFL, O_NONBLOCK);
+    signal(SIGCHLD, serverChildSignal);
+
+    time_t timeCurrent;
+    time(&timeCurrent);
+    P->inOut->logMain << "Alignment server is listening on " << P->serverSocket <<"\n"<<flush;
+    *P->inOut->logStdOut << timeMonthDayTime(timeCurrent) << " ..... Alignment server is ready, listening on " << P->serverSocket <<"\n" <<flush;
+
+    std::map <pid_t, ServerJob> jobs;
+    uint jobN=0;
+    while (true) {
+        int status;
+        pid_t pid;
+        while ((pid=waitpid(-1, &status, WNOHANG))>0) {//the job processes have sent the exit codes to the clients
+            std::map <pid_t, ServerJob>::iterator job1=jobs.find(pid);
+            if (job1==jobs.end()) continue;
+            close(job1->second.connFD);
+            time(&timeCurrent);
+            P->inOut->logMain << timeMonthDayTime(timeCurrent) << " job " << job1->second.jobID << " finished with exit code " << (WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status)) <<"\n"<<flush;
+            jobs.erase(job1);
+        };
+
+        struct pollfd pollFDs[2]={{listenFD, POLLIN, 0}, {serverChildPipe[0], POLLIN, 0}};
+        if (poll(pollFDs, 2, -1)<=0) continue; //interrupted by a signal
+        if (pollFDs[1].revents & POLLIN) {
+            char buf[256];
+            while (read(serverChildPipe[0], buf, sizeof(buf))>0) {};
+        };
+        if (!(pollFDs[0].revents & POLLIN)) continue;
+
+        int connFD=accept(listenFD, NULL, NULL);
+        if (connFD<0) continue;
+        if (!serverPeerAllowed(connFD)) {
+            time(&timeCurrent);
+            P->inOut->logMain << timeMonthDayTime(timeCurrent) << " WARNING: rejected a job from another user\n"<<flush;
+            string errOut="EXITING because of FATAL ERROR: the alignment server accepts jobs only from the user that started it\n";
+            errOut+="SOLUTION: start your own server with --runMode alignServer\n";
+            sendRecord(connFD, SERVER_RECORD_OUTPUT, errOut.data(), errOut.size());
+            sendExitRecord(connFD, EXIT_CODE_PARAMETER);
+            close(connFD);
+            continue;
+        };
+        jobN++;
+        P->inOut->logMain << flush;
+        cout << flush;
+        cerr << flush;
+        pid=fork();
+        if (pid==0) {//the job process
+            close(listenFD);
+            for (std::map <pid_t, ServerJob>::iterator job1=jobs.begin(); job1!=jobs.end(); job1++) close(job1->second.connFD);
+            return alignServerJob(P, mainGenome, connFD);
+        } else if (pid<0) {
+            P->inOut->logMain << "WARNING: could not start job " << jobN << ", error from fork(): " << strerror(errno) <<"\n"<<flush;
+            sendExitRecord(connFD, EXIT_CODE_RUNTIME);
+            close(connFD);
+            continue;
+        };
+        ServerJob job1={jobN, connFD};
+        jobs[pid]=job1;
+        time(&timeCurrent);
+        P->inOut->logMain << timeMonthDayTime(timeCurrent) << " job " << jobN << " started, process " << pid <<"\n"<<flush;
+    };
+};
+
+bool alignClientMode(int argInN, char* argIn[]) {
+    for (int ii=1; ii+1<argInN; ii++) {
+        if (string(argIn[ii])=="--runMode" && string(argIn[ii+1])=="alignClient") return true;
+    };
+    return false;
+};
+
+int alignClient(int argInN, char* argIn[]) {
+    //the client does not parse the parameters: the job command line is sent to the server, except --runMode and --serverSocket.
+    //--genomeDir and --genomeLoad are rejected: the genome is defined by the server
+    string socketPath="";
+    vector <string> jobArgs;
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, PATH_MAX)==NULL) {
+        cerr << "EXITING because of FATAL ERROR: could not get the current working directory: " << strerror(errno) <<"\n" <<flush;
+        return EXIT_CODE_RUNTIME;
+    };
+    jobArgs.push_back(cwd);
+    for (int ii=1; ii<argInN; ii++) {
+        string arg1(argIn[ii]);
+        if (arg1=="--runMode") {
+            ii++;
+        } else if (arg1=="--serverSocket" && ii+1<argInN) {
+            ii++;
+            socketPath=argIn[ii];
+        } else if (arg1=="--genomeDir" || arg1=="--genomeLoad") {
+            cerr << "EXITING because of FATAL INPUT ERROR: " << arg1 << " cannot be used with --runMode alignClient, the jobs are mapped to the genome loaded by the alignment server\n";
+            cerr << "SOLUTION: remove " << arg1 << " from the command line, or start a server with the required genome\n" <<flush;
+            return EXIT_CODE_PARAMETER;
+        } else {
+            jobArgs.push_back(arg1);
+        };
+    };
+
+    struct sockaddr_un addr;
+    if (socketPath=="" || !socketAddress(socketPath, addr)) {
+        cerr << "EXITING because of FATAL INPUT ERROR: --runMode alignClient requires the path of the server socket\n";
+        cerr << "SOLUTION: specify --serverSocket /path/to/socket, as used for --runMode alignServer\n" <<flush;
+        return EXIT_CODE_PARAMETER;
+    };
+    int connFD=socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connFD<0 || connect(connFD, (struct sockaddr*) &addr, sizeof(addr))!=0) {
+        cerr << "EXITING because of FATAL ERROR: could not connect to the alignment server on " << socketPath << " : " << strerror(errno) <<"\n";
+        cerr << "SOLUTION: start the server with STAR --runMode alignServer --serverSocket " << socketPath << " --genomeDir ...\n" <<flush;
+        return EXIT_CODE_RUNTIME;
+    };
+
+    string jobString;
+    uint32 n1=jobArgs.size();
+    jobString.append((char*) &n1, sizeof(n1));
+    for (uint ii=0; ii<jobArgs.size(); ii++) {
+        n1=jobArgs[ii].size();
+        jobString.append((char*) &n1, sizeof(n1));
+        jobString+=jobArgs[ii];
+    };
+    bool jobSent=sendAll(connFD, jobString.data(), jobString.size()); //if the server rejected the job, its message is still read below
+    int sendErrno=errno;
+
+    vector <char> buf;
+    char header[5];
+    while (recvAll(connFD, header, sizeof(header))) {//copy the job output until the exit code
+        memcpy(&n1, header+1, sizeof(n1));
+        if (buf.size()<n1) buf.resize(n1);
+        if (n1>0 && !recvAll(connFD, buf.data(), n1)) break;
+        if (header[0]==SERVER_RECORD_OUTPUT) {
+            cout.write(buf.data(), n1);
+        } else if (header[0]==SERVER_RECORD_EXIT && n1==sizeof(int32_t)) {
+            int32_t exitCode;
+            memcpy(&exitCode, buf.data(), sizeof(exitCode));
+            cout << flush;
+            return exitCode;
+        } else {
+            break;
+        };
+    };
+    cout << flush;
+    if (!jobSent) {
+        cerr << "EXITING because of FATAL ERROR: could not send the job to the alignment server: " << strerror(sendErrno) <<"\n" <<flush;
+        return EXIT_CODE_RUNTIME;
+    };
+    cerr << "EXITING because of FATAL ERROR: the connection to the alignment server was closed before the job finished\n" <<flush;
+    return EXIT_CODE_RUNTIME;
+};
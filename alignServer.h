@@ -0,0 +1,12 @@
+#ifndef DEF_alignServer
+#define DEF_alignServer
+
+#include "IncludeDefine.h"
+#include "Parameters.h"
+#include "Genome.h"
+
+Parameters* alignServer(Parameters *P, Genome &mainGenome); //accept jobs on the server socket; returns only in the process forked for a job, with the job parameters
+bool alignClientMode(int argInN, char* argIn[]); //--runMode alignClient is requested
+int alignClient(int argInN, char* argIn[]); //submit the job to the server and wait for it to finish, returns the exit code of the job
+
+#endif
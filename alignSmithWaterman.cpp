@@ -1,152 +1,335 @@
-#include "IncludeDefine.h"
-#include "Transcript.h"
-// local alignment with Smith-Waterman algorithm
-intSWscore alignSmithWaterman(char *R, uint rL, char *G, uint gL, \
-        intSWscore pMatch, intSWscore pMismatch, intSWscore pGapOpen, intSWscore pGapExtend, \
-        char* T, uint Tsize, Transcript &trA) {
-    
-    intSWscore *H=new intSWscore[rL+1];
-    
-    uint rL1=rL+1;
-    if (rL1*(gL+1)>Tsize) return (intSWscore) 0;
-    
-    intSWscore *E=new intSWscore[rL1];
-    
-    memset(H,0,sizeof(H[0])*(rL1));
-    memset(E,0,sizeof(E[0])*(rL1));
-    
-
-    
-    intSWscore maxH=0;
-    uint maxHr=0, maxHg=0;
-    
-    for (uint ig=1;ig<=gL;ig++) {//cycle over colums
-        intSWscore F=(intSWscore) 0;
-        intSWscore HdiagPrev=0;
-        for (uint ir=1;ir<=rL;ir++) {//cycle over rows
-            
-            E[ir]=max( E[ir]-pGapExtend, H[ir]-pGapOpen );
-            E[ir]=max( E[ir], (intSWscore) 0 );
-            
-            F = max( F-pGapExtend, H[ir-1]-pGapOpen );
-            F = max( F, (intSWscore) 0);
-            
-            intSWscore Hdiag = G[ig-1]==R[ir-1] ? HdiagPrev+pMatch : HdiagPrev-pMismatch;
-            
-//             if (H[ir]>E[ir] & H[ir]>F)
-                
-            HdiagPrev=H[ir];  
-            
-            if (F>Hdiag && F>E[ir]) {//insertion (gap in read)
-                H[ir]=F;
-                T[ir+ig*rL1]=1;
-            } else if (Hdiag>F && Hdiag>E[ir]) {//match-mismatch
-                H[ir]=Hdiag;
-                T[ir+ig*rL1]=2;
-            } else {//deletion (gap in genome)
-                H[ir]=E[ir];
-                T[ir+ig*rL1]=3;                
+#include "alignSmithWaterman.h"
+// local alignment with Smith-Waterman algorithm, affine gaps:
+// H=max(0, Hdiag+pMatch or Hdiag-pMismatch, E, F), E - gap in the genome (deletion), F - gap in the read (insertion), columns - genome, rows - read
+// The score pass keeps one DP column, and the H and E columns every checkStep genome bases (checkpoints).
+// The traceback recomputes the blocks of columns between the checkpoints backwards from the max cell, for the rows up to the max cell,
+// and records the traceback values for one block at a time.
+// Both passes use the striped AVX2 kernel (Farrar 2007) when the CPU supports it: 16-bit lanes if the max possible score fits, 32-bit lanes otherwise.
+
+#define SW_PROFILE_CODES 8 //read profiles for the genome codes 0...SW_PROFILE_CODES-1, the other codes use one more profile rebuilt when the code changes
+
+struct SWpass {//DP over the columns g0+1...g1, for the rows 1...rL
+    const char *R, *G;
+    uint rL, g0, g1;
+    intSWscore pMatch, pMismatch, pGapOpen, pGapExtend;
+    const intSWscore *H0, *E0; //H of the column g0 and E of the column g0+1, for the rows 1...rL; NULL: zeros
+    intSWscore *checkH, *checkE; //H and E recorded at the columns multiple of checkStep, NULL: not recorded
+    uint checkStep;
+    char *T; //traceback values of the column ig, row ir: T[(ig-g0-1)*rL+ir-1]; NULL: not recorded
+    intSWscore maxH; //max score and its cell, the first one in the column-major order
+    uint maxHr, maxHg;
+};
+
+static inline char swTraceValue(intSWscore H, intSWscore Hdiag, intSWscore F) {//0: alignment start, 1: gap in the read, 2: match/mismatch, 3: gap in the genome
+    if (H==0) return 0;
+    if (Hdiag==H) return 2;
+    if (F==H) return 1;
+    return 3;
+};
+
+static void swPassScalar(SWpass &S, SWbuffers &B) {
+    B.dp.resize(2*S.rL*sizeof(intSWscore));
+    intSWscore *H=(intSWscore*) B.dp.data(), *E=H+S.rL;
+    for (uint ir=0; ir<S.rL; ir++) {
+        H[ir] = S.H0==NULL ? 0 : S.H0[ir];
+        E[ir] = S.E0==NULL ? 0 : S.E0[ir];
+    };
+
+    for (uint ig=S.g0+1; ig<=S.g1; ig++) {//cycle over columns
+        char g1=S.G[ig-1];
+        char *T1 = S.T==NULL ? NULL : S.T+(ig-S.g0-1)*S.rL;
+        intSWscore F=0, HdiagPrev=0;
+        for (uint ir=0; ir<S.rL; ir++) {//cycle over rows, ir is the row ir+1
+            intSWscore Hdiag = g1==S.R[ir] ? HdiagPrev+S.pMatch : HdiagPrev-S.pMismatch;
+            intSWscore H1 = max( max(Hdiag, E[ir]), max(F, (intSWscore) 0) );
+            if (T1!=NULL) T1[ir]=swTraceValue(H1, Hdiag, F);
+
+            E[ir] = max( max(E[ir]-S.pGapExtend, H1-S.pGapOpen), (intSWscore) 0 );
+            F = max( max(F-S.pGapExtend, H1-S.pGapOpen), (intSWscore) 0 );
+            HdiagPrev=H[ir];
+            H[ir]=H1;
+
+            if (H1>S.maxH) {
+                S.maxH=H1;
+                S.maxHr=ir+1;
+                S.maxHg=ig;
+            };
+        };
+        if (S.checkH!=NULL && ig%S.checkStep==0) {
+            memcpy(S.checkH+ig/S.checkStep*S.rL, H, S.rL*sizeof(intSWscore));
+            memcpy(S.checkE+ig/S.checkStep*S.rL, E, S.rL*sizeof(intSWscore));
+        };
+    };
+};
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+    #define SW_SIMD
+    #include <immintrin.h>
+#endif
+
+#ifdef SW_SIMD
+
+static bool cpuSupportsAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+};
+static const bool swAVX2=cpuSupportsAVX2(); //runtime dispatch, checked once
+
+struct SWlanes16 {//the scores stay within int16, no saturation is needed
+    typedef int16_t Score;
+    static const uint n=16;
+    __attribute__((always_inline,target("avx2"))) static inline __m256i set1(intSWscore a) {return _mm256_set1_epi16((short) a);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i add(__m256i a, __m256i b) {return _mm256_add_epi16(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i sub(__m256i a, __m256i b) {return _mm256_sub_epi16(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i max(__m256i a, __m256i b) {return _mm256_max_epi16(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i gt(__m256i a, __m256i b) {return _mm256_cmpgt_epi16(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i eq(__m256i a, __m256i b) {return _mm256_cmpeq_epi16(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i shift(__m256i a) {//lane l+1 = lane l, lane 0 = 0
+        return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 14);
+    };
+};
+
+struct SWlanes32 {
+    typedef int32_t Score;
+    static const uint n=8;
+    __attribute__((always_inline,target("avx2"))) static inline __m256i set1(intSWscore a) {return _mm256_set1_epi32(a);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i add(__m256i a, __m256i b) {return _mm256_add_epi32(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i sub(__m256i a, __m256i b) {return _mm256_sub_epi32(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i max(__m256i a, __m256i b) {return _mm256_max_epi32(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i gt(__m256i a, __m256i b) {return _mm256_cmpgt_epi32(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i eq(__m256i a, __m256i b) {return _mm256_cmpeq_epi32(a,b);};
+    __attribute__((always_inline,target("avx2"))) static inline __m256i shift(__m256i a) {
+        return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 12);
+    };
+};
+
+template <class L> static void swProfileFill(__m256i *p, const SWpass &S, uint segLen, uint code) {
+    //striped scores of the read bases vs the genome code: row ir is in the lane ir/segLen of the vector ir%segLen
+    //the padding rows after the read end get a score low enough to keep their H away from the max
+    typename L::Score *p1=(typename L::Score*) p;
+    intSWscore padScore = -(intSWscore) S.rL*S.pMatch-1;
+    for (uint s=0; s<segLen; s++) {
+        for (uint l=0; l<L::n; l++) {
+            uint ir=s+l*segLen;
+            p1[s*L::n+l] = (typename L::Score) ( ir>=S.rL ? padScore : ((unsigned char) S.R[ir]==code ? S.pMatch : -S.pMismatch) );
+        };
+    };
+};
+
+template <class L> __attribute__((target("avx2"))) static void swPassStriped(SWpass &S, SWbuffers &B) {
+    typedef typename L::Score Score;
+    const uint nL=L::n, segLen=(S.rL+nL-1)/nL;
+
+    B.dp.resize((SW_PROFILE_CODES+6)*segLen*sizeof(__m256i)+sizeof(__m256i));
+    __m256i *prof=(__m256i*) (((uintptr_t) B.dp.data()+sizeof(__m256i)-1) & ~(uintptr_t) (sizeof(__m256i)-1));
+    __m256i *Hprev=prof+(SW_PROFILE_CODES+1)*segLen, *Hcur=Hprev+segLen, *E=Hcur+segLen, *F=E+segLen, *Hd=F+segLen;
+    bool profDone[SW_PROFILE_CODES];
+    for (uint ii=0; ii<SW_PROFILE_CODES; ii++) profDone[ii]=false;
+    uint profExtraCode=(uint) -1;
+
+    Score *h=(Score*) Hprev, *e=(Score*) E;
+    for (uint s=0; s<segLen; s++) {
+        for (uint l=0; l<nL; l++) {
+            uint ir=s+l*segLen;
+            h[s*nL+l] = (Score) ( ir>=S.rL || S.H0==NULL ? 0 : S.H0[ir] );
+            e[s*nL+l] = (Score) ( ir>=S.rL || S.E0==NULL ? 0 : S.E0[ir] );
+        };
+    };
+
+    const __m256i vZero=_mm256_setzero_si256(), vOpen=L::set1(S.pGapOpen), vExt=L::set1(S.pGapExtend);
+    for (uint ig=S.g0+1; ig<=S.g1; ig++) {//cycle over columns
+        uint code=(unsigned char) S.G[ig-1];
+        const __m256i *p;
+        if (code<SW_PROFILE_CODES) {
+            p=prof+code*segLen;
+            if (!profDone[code]) {
+                swProfileFill<L>(prof+code*segLen, S, segLen, code);
+                profDone[code]=true;
+            };
+        } else {
+            p=prof+SW_PROFILE_CODES*segLen;
+            if (code!=profExtraCode) {
+                swProfileFill<L>(prof+SW_PROFILE_CODES*segLen, S, segLen, code);
+                profExtraCode=code;
+            };
+        };
+
+        __m256i vHd=L::shift(_mm256_load_si256(Hprev+segLen-1)), vF=vZero, vMax=vZero;
+        for (uint s=0; s<segLen; s++) {//F is propagated within the lanes only
+            vHd=L::add(vHd, _mm256_load_si256(p+s));
+            __m256i vE=_mm256_load_si256(E+s);
+            __m256i vH=L::max( L::max(vHd, vE), L::max(vF, vZero) );
+            if (S.T!=NULL) _mm256_store_si256(Hd+s, vHd);
+            _mm256_store_si256(F+s, vF);
+            _mm256_store_si256(Hcur+s, vH);
+            vMax=L::max(vMax, vH);
+
+            __m256i vHo=L::sub(vH, vOpen);
+            _mm256_store_si256(E+s, L::max( L::max(L::sub(vE, vExt), vHo), vZero ));
+            vF=L::max( L::max(L::sub(vF, vExt), vHo), vZero );
+            vHd=_mm256_load_si256(Hprev+s);
+        };
+
+        //lazy F: the gaps in the read that continue from one lane into the next one, until they do not increase F
+        vF=L::shift(vF);
+        for (uint s=0; _mm256_movemask_epi8(L::gt(vF, _mm256_load_si256(F+s)))!=0; ) {
+            _mm256_store_si256(F+s, L::max(vF, _mm256_load_si256(F+s)));
+            __m256i vH=L::max(_mm256_load_si256(Hcur+s), vF);
+            _mm256_store_si256(Hcur+s, vH);
+            vMax=L::max(vMax, vH);
+
+            __m256i vHo=L::sub(vH, vOpen);
+            _mm256_store_si256(E+s, L::max(_mm256_load_si256(E+s), vHo));
+            vF=L::max( L::max(L::sub(vF, vExt), vHo), vZero );
+            if (++s==segLen) {
+                s=0;
+                vF=L::shift(vF);
             };
-            
-            if (H[ir]<0) {
-                H[ir]=0;
+        };
+
+        if (S.T!=NULL) {//same values as swTraceValue
+            char *T1=S.T+(ig-S.g0-1)*S.rL;
+            Score t[nL];
+            for (uint s=0; s<segLen; s++) {
+                __m256i vH=_mm256_load_si256(Hcur+s);
+                __m256i vT=_mm256_blendv_epi8(L::set1(3), L::set1(1), L::eq(_mm256_load_si256(F+s), vH));
+                vT=_mm256_blendv_epi8(vT, L::set1(2), L::eq(_mm256_load_si256(Hd+s), vH));
+                vT=_mm256_andnot_si256(L::eq(vH, vZero), vT);
+                _mm256_storeu_si256((__m256i*) t, vT);
+                for (uint l=0, ir=s; l<nL && ir<S.rL; l++, ir+=segLen) T1[ir]=(char) t[l];
             };
-            
-            if (H[ir]==0) {
-                T[ir+ig*rL1]=0;
+        };
+
+        if (S.checkH!=NULL && ig%S.checkStep==0) {
+            h=(Score*) Hcur;
+            e=(Score*) E;
+            for (uint ir=0; ir<S.rL; ir++) {
+                S.checkH[ig/S.checkStep*S.rL+ir]=h[(ir%segLen)*nL+ir/segLen];
+                S.checkE[ig/S.checkStep*S.rL+ir]=e[(ir%segLen)*nL+ir/segLen];
             };
-            
-//             Hdiag=max(Hdiag,E[ir]);
-//             Hdiag=max(Hdiag,F);
-//             H[ir]=max(Hdiag,(intSWscore) 0);
-            
-            if (H[ir]>maxH) {
-                maxH=H[ir];
-                maxHr=ir;
-                maxHg=ig;
+        };
+
+        if (_mm256_movemask_epi8(L::gt(vMax, L::set1(S.maxH)))!=0) {//the max increased in this column: find its first row
+            h=(Score*) Hcur;
+            for (uint ir=0; ir<S.rL; ir++) {
+                intSWscore H1=h[(ir%segLen)*nL+ir/segLen];
+                if (H1>S.maxH) {
+                    S.maxH=H1;
+                    S.maxHr=ir+1;
+                    S.maxHg=ig;
+                };
             };
-            #ifdef DEBUG_SW
-                stdOut << setw(2)<<H[ir]<<"  ";
-                if (ir==rL) stdOut<<endl;
-            #endif
+        };
+
+        swap(Hprev, Hcur);
+    };
+};
+
+#endif
+
+static void swPass(SWpass &S, SWbuffers &B) {
+#ifdef SW_SIMD
+    if (swAVX2) {//lanes are selected from the max possible score, and the penalties
+        uint64 scoreMax=(uint64) S.rL*S.pMatch;
+        intSWscore penMax=max(max(S.pMismatch, S.pGapOpen), S.pGapExtend);
+        if (scoreMax<32767 && penMax<32767) {
+            swPassStriped<SWlanes16>(S,B);
+            return;
+        } else if (scoreMax<(1LLU<<30) && penMax<(1<<30)) {
+            swPassStriped<SWlanes32>(S,B);
+            return;
         };
     };
-    
-    //traceback the alignment
-    //last operation should always be match
-    if (T[maxHr+maxHg*rL1]!=2) {
+#endif
+    swPassScalar(S,B);
+};
+
+intSWscore alignSmithWaterman(char *R, uint rL, char *G, uint gL, \
+        intSWscore pMatch, intSWscore pMismatch, intSWscore pGapOpen, intSWscore pGapExtend, \
+        SWbuffers &swBuf, Transcript &trA) {
+
+    SWpass S;
+    S.R=R; S.G=G;
+    S.pMatch=pMatch; S.pMismatch=pMismatch; S.pGapOpen=pGapOpen; S.pGapExtend=pGapExtend;
+
+    //score pass, with the checkpoints
+    uint checkStep=64;
+    while (checkStep*checkStep<8*gL) checkStep*=2; //similar memory for the checkpoints and for the traceback values of one block
+    swBuf.checkH.resize((gL/checkStep+1)*rL);
+    swBuf.checkE.resize((gL/checkStep+1)*rL);
+    memset(swBuf.checkH.data(), 0, rL*sizeof(intSWscore)); //column 0
+    memset(swBuf.checkE.data(), 0, rL*sizeof(intSWscore));
+
+    S.rL=rL; S.g0=0; S.g1=gL;
+    S.H0=NULL; S.E0=NULL;
+    S.checkH=swBuf.checkH.data(); S.checkE=swBuf.checkE.data(); S.checkStep=checkStep;
+    S.T=NULL;
+    S.maxH=0; S.maxHr=0; S.maxHg=0;
+    swPass(S,swBuf);
+
+    intSWscore maxH=S.maxH;
+    uint maxHr=S.maxHr, maxHg=S.maxHg;
+
+    //traceback the alignment, block by block
+    swBuf.T.resize(checkStep*maxHr);
+    uint ig=maxHg, ir=maxHr;
+    char prevOper=0, T1=2;
+    if (maxH==0) {//no matching bases: the last operation is not match
         cerr <<"BUG in SW, last operation is mot match, EXITING"<<endl<<flush;
         exit(1);
     };
-    trA.nExons=0;
-    uint ig=maxHg, ir=maxHr;
-    char prevOper=0;
-    
+
     trA.nExons=-1;
-    while (T[ir+ig*rL1]>0 && ir>0 && ig>0) {
-        if (T[ir+ig*rL1]==2) {
-            if (prevOper==2) {//increase length
-                trA.exons[trA.nExons][EX_L]++;
-            } else {//new exon
-                ++trA.nExons;                  
-                trA.exons[trA.nExons][EX_L]=1;
-                trA.exons[trA.nExons][EX_R]=ir;
-                trA.exons[trA.nExons][EX_G]=ig;
-                prevOper=2;
+    while (T1>0 && ir>0 && ig>0) {
+        uint gCheck=(ig-1)/checkStep*checkStep; //checkpoint before the block
+        S.rL=maxHr; S.g0=gCheck; S.g1=ig;
+        S.H0=swBuf.checkH.data()+gCheck/checkStep*rL; S.E0=swBuf.checkE.data()+gCheck/checkStep*rL;
+        S.checkH=NULL; S.checkE=NULL;
+        S.T=swBuf.T.data();
+        swPass(S,swBuf);
+
+        //last operation should always be match
+        if (ig==maxHg && ir==maxHr && S.T[(ig-gCheck-1)*maxHr+ir-1]!=2) {
+            cerr <<"BUG in SW, last operation is mot match, EXITING"<<endl<<flush;
+            exit(1);
+        };
+
+        while (ir>0 && ig>gCheck) {
+            T1=S.T[(ig-gCheck-1)*maxHr+ir-1];
+            if (T1==0) break;
+            if (T1==2) {
+                if (prevOper==2) {//increase length
+                    trA.exons[trA.nExons][EX_L]++;
+                } else {//new exon
+                    ++trA.nExons;
+                    trA.exons[trA.nExons][EX_L]=1;
+                    trA.exons[trA.nExons][EX_R]=ir;
+                    trA.exons[trA.nExons][EX_G]=ig;
+                    prevOper=2;
+                };
+                --ir;
+                --ig;
+            } else if (T1==1) {//gap in read
+                --ir;
+                prevOper=1;
+            } else {//gap in genome
+                --ig;
+                prevOper=3;
             };
-            --ir;
-            --ig;
-        } else if (T[ir+ig*rL1]==1) {//gap in read
-            --ir;
-            prevOper=1;
-        } else {//gap in genome
-            --ig;
-            prevOper=3;
         };
-    };  
-    
+    };
+
     ++trA.nExons;
     for (uint ii=0;ii<trA.nExons;ii++) {//subtract length
-        trA.exons[ii][EX_R] -= trA.exons[ii][EX_L]; //note that exon loci have extra +1 because T matrix is shifted by +1
-        trA.exons[ii][EX_G] -= trA.exons[ii][EX_L];        
+        trA.exons[ii][EX_R] -= trA.exons[ii][EX_L]; //note that exon loci have extra +1 because DP rows and columns are shifted by +1
+        trA.exons[ii][EX_G] -= trA.exons[ii][EX_L];
     };
-    
+
     for (uint ii=0;ii<trA.nExons/2;ii++) {//reverse order
         for (uint jj=0;jj<EX_SIZE;jj++) {
             swap(trA.exons[ii][jj],trA.exons[trA.nExons-1-ii][jj]);
         };
-    };    
-    
-//     for (uint ii=1;ii<trA.nExons;ii++) {//subtract EX_G of the first exon
-//         trA.exons[ii][EX_G] -= trA.exons[0][EX_G];        
-//     };
-    
-    
-    
-    #ifdef DEBUG_SW
-            for (uint jj=0;jj<3;jj++) {        
-                for (uint ii=0;ii<trA.nExons;ii++) {
-                    stdOut << trA.exons[jj][trA.nExons-1-ii]<<",";
-                };
-                stdOut <<"\t";
-            };
-            stdOut <<endl;    
-            stdOut << maxHr <<"\t"<< maxHg << endl;
-            for (int ir=0;ir<=rL;ir++){
-                for (int ig=0;ig<=gL;ig++){
-                    stdOut << setw(2) << int(T[ir+ig*rL1]) <<"  ";
-                };
-                stdOut <<endl;
-            };            
-    #endif
-//     uint ig=maxHg, ir=maxHr;
-//     uint* rMap=new uint [rL];
-//     int H1, F1, E1;
-//     while (ir>=1 && ig>=1) {
-//         
-//         rMap[ir-1]=ig;
-//         
-//     };
-
-    return maxH;  
+    };
+
+    return maxH;
 };
@@ -1,2 +1,16 @@
+#ifndef DEF_alignSmithWaterman
+#define DEF_alignSmithWaterman
+
 #include "IncludeDefine.h"
-intSWscore alignSmithWaterman(char *R, uint rL, char *G, uint gL, intSWscore pMatch, intSWscore pMismatch, intSWscore pGapOpen, intSWscore pGapExtend, char* T, uint Tsize, Transcript &trA);
+#include "Transcript.h"
+
+struct SWbuffers {//work arrays of alignSmithWaterman, kept per ReadAlign and only grown
+    vector <char> dp; //DP columns and the read profile
+    vector <intSWscore> checkH, checkE; //H and E columns at the checkpoints
+    vector <char> T; //traceback values for one block of columns
+};
+
+intSWscore alignSmithWaterman(char *R, uint rL, char *G, uint gL, intSWscore pMatch, intSWscore pMismatch, intSWscore pGapOpen, intSWscore pGapExtend, SWbuffers &swBuf, Transcript &trA);
+    //local alignment of the read R[0...rL) to the genome G[0...gL), returns the max score, records the aligned blocks in trA.exons
+
+#endif
@@ -0,0 +1,136 @@
+#include "bamSortByCoordinate.h"
+#include "BAMoutput.h"
+#include "ErrorWarning.h"
+#include "TimeFunctions.h"
+#include "sysRemoveDir.h"
+#include "serviceFuns.cpp"
+#include SAMTOOLS_BGZF_H
+
+#define BAM_CAT_BUFFER_SIZE 16777216
+
+void bamSortByCoordinate (ReadAlignChunk** RAchunk, Parameters* P) {//sort each bin in parallel, concatenate compressed bins into the sorted BAM file
+    time_t rawTime;
+    time(&rawTime);
+    P->inOut->logMain     << timeMonthDayTime(rawTime) << " ..... Started sorting BAM\n" <<flush;
+    *P->inOut->logStdOut  << timeMonthDayTime(rawTime) << " ..... Started sorting BAM\n" <<flush;
+
+    uint binN=RAchunk[0]->chunkOutBAMcoord->binN;
+    uint *binTotalBytes=new uint [binN];
+    uint *binTotalN=new uint [binN];
+    uint *binBGZFbytes=new uint [binN];
+    memset(binTotalBytes,0,binN*sizeof(uint));
+    memset(binTotalN,0,binN*sizeof(uint));
+
+    for (int it=0;it<P->runThreadN;it++) {//write the remaining alignments to disk, collect bin sizes from all threads
+        RAchunk[it]->chunkOutBAMcoord->coordFlush();
+        for (uint ib=0;ib<binN;ib++) {
+            binTotalBytes[ib]+=RAchunk[it]->chunkOutBAMcoord->binTotalBytes[ib];
+            binTotalN[ib]+=RAchunk[it]->chunkOutBAMcoord->binTotalN[ib];
+        };
+    };
+
+    //RAM needed to sort one bin: alignments + sorting array
+    uint binRAMmax=0;
+    for (uint ib=0;ib<binN;ib++) {
+        binRAMmax=max(binRAMmax,binTotalBytes[ib]+binTotalN[ib]*3*sizeof(uint));
+    };
+
+    uint limitRAM=(P->limitBAMsortRAM>0 ? P->limitBAMsortRAM : P->nGenome+P->nSAbyte);
+    if (binRAMmax>limitRAM) {
+        ostringstream errOut;
+        errOut <<"EXITING because of fatal ERROR: not enough memory for BAM sorting: the largest bin requires " << binRAMmax << " bytes, limitBAMsortRAM=" << limitRAM <<"\n";
+        errOut <<"SOLUTION: re-run STAR with at least --limitBAMsortRAM " << binRAMmax <<" , or increase --outBAMsortingBinsN\n";
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_PARAMETER, *P);
+    };
+    int sortThreadN=(int) min( (uint) P->runThreadN, limitRAM/max(binRAMmax,(uint) 1) );
+    P->inOut->logMain << "BAM sorting: " << binN << " bins, max RAM for one bin = " << binRAMmax <<" bytes, number of sorting threads = " << sortThreadN <<"\n"<<flush;
+
+    #pragma omp parallel for num_threads(sortThreadN) schedule(dynamic,1)
+    for (int iBin=0; (uint)iBin<binN; iBin++) {//sort each bin and write it into a separate BGZF file
+        binBGZFbytes[iBin]=0;
+        if (binTotalN[iBin]==0) continue;
+
+        char *bamIn=new char [binTotalBytes[iBin]];
+        uint bamInBytes=0;
+        for (int it=0;it<P->runThreadN;it++) {//load the bin files from all threads
+            string binFileName=RAchunk[it]->chunkOutBAMcoord->binDir+to_string((uint) iBin);
+            ifstream binFile(binFileName.c_str(), ios::binary);
+            if (!binFile.good()) continue;//no alignments in this bin for this thread
+            binFile.read(bamIn+bamInBytes,binTotalBytes[iBin]-bamInBytes);
+            bamInBytes+=binFile.gcount();
+            binFile.close();
+            remove(binFileName.c_str());
+        };
+
+        if (bamInBytes!=binTotalBytes[iBin]) {
+            ostringstream errOut;
+            errOut <<"EXITING because of fatal ERROR: could not read BAM sorting bin " << iBin <<": expected " << binTotalBytes[iBin] << " bytes, read "<< bamInBytes <<" bytes\n";
+            errOut <<"SOLUTION: check that the disk is not full and the temporary directory " << P->outFileTmp <<" was not modified during the run\n";
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+        };
+
+        //sorting array: refID+pos, read number, record start
+        uint *startPos=new uint [binTotalN[iBin]*3];
+        for (uint ib=0,ia=0; ia<binTotalN[iBin]; ia++) {
+            uint32 *bamIn32=(uint32*) (bamIn+ib);
+            startPos[ia*3]  =( ((uint) bamIn32[1]) << 32) | ( (uint) bamIn32[2] );
+            startPos[ia*3+2]=ib;
+            ib+=bamIn32[0]+sizeof(uint32);
+            startPos[ia*3+1]=*( (uint*) (bamIn+ib) );
+            ib+=sizeof(uint);
+        };
+
+        qsort((void*) startPos, binTotalN[iBin], sizeof(uint)*3, funCompareArrays<uint,3>);
+
+        BGZF *bgzfBin=bgzf_open((P->outFileTmp+"/BAMsort/b"+to_string((uint) iBin)).c_str(),("w"+to_string((long long) P->outBAMcompression)).c_str());
+        for (uint ia=0; ia<binTotalN[iBin]; ia++) {
+            char *bam1=bamIn+startPos[ia*3+2];
+            bgzf_write(bgzfBin,bam1,*((uint32*) bam1)+sizeof(uint32));
+        };
+        bgzf_flush(bgzfBin);
+        binBGZFbytes[iBin]=bgzfBin->block_address;//compressed size without the EOF block, which is added by bgzf_close
+        bgzf_close(bgzfBin);
+
+        delete [] startPos;
+        delete [] bamIn;
+    };
+
+    time(&rawTime);
+    P->inOut->logMain << timeMonthDayTime(rawTime) << " ..... Concatenating sorted BAM bins\n" <<flush;
+
+    //the header has been written already, append compressed bins directly to the output file
+    bgzf_flush(P->inOut->outBAMfileCoord);
+    FILE *bamOut=(FILE*) P->inOut->outBAMfileCoord->fp;
+    char *catBuffer=new char [BAM_CAT_BUFFER_SIZE];
+    for (uint ib=0;ib<binN;ib++) {
+        if (binBGZFbytes[ib]==0) continue;
+        string binFileName=P->outFileTmp+"/BAMsort/b"+to_string(ib);
+        ifstream binFile(binFileName.c_str(), ios::binary);
+        uint bytesLeft=binBGZFbytes[ib];
+        while (bytesLeft>0 && binFile.good()) {
+            binFile.read(catBuffer,min(bytesLeft,(uint) BAM_CAT_BUFFER_SIZE));
+            uint bytesRead=binFile.gcount();
+            if (fwrite(catBuffer,1,bytesRead,bamOut)!=bytesRead) {
+                ostringstream errOut;
+                errOut <<"EXITING because of fatal ERROR: could not write to the sorted BAM file " << P->outFileNamePrefix << "Aligned.out.SortCoordinate.bam\n";
+                errOut <<"SOLUTION: check that the disk is not full and you have permission to write this file\n";
+                exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_RUNTIME, *P);
+            };
+            bytesLeft-=bytesRead;
+        };
+        binFile.close();
+        remove(binFileName.c_str());
+    };
+    delete [] catBuffer;
+
+    for (int it=0;it<P->runThreadN;it++) sysRemoveDir(RAchunk[it]->chunkOutBAMcoord->binDir);
+    sysRemoveDir(P->outFileTmp+"/BAMsort/");
+
+    delete [] binTotalBytes;
+    delete [] binTotalN;
+    delete [] binBGZFbytes;
+
+    time(&rawTime);
+    P->inOut->logMain     << timeMonthDayTime(rawTime) << " ..... Finished sorting BAM\n" <<flush;
+    *P->inOut->logStdOut  << timeMonthDayTime(rawTime) << " ..... Finished sorting BAM\n" <<flush;
+};
@@ -0,0 +1,9 @@
+#ifndef DEF_bamSortByCoordinate
+#define DEF_bamSortByCoordinate
+
+#include "ReadAlignChunk.h"
+#include "Parameters.h"
+
+void bamSortByCoordinate (ReadAlignChunk** RAchunk, Parameters* P);
+
+#endif
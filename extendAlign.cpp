@@ -2,16 +2,26 @@
 #include "Parameters.h"
 #include "Transcript.h"
 #include "extendAlign.h"
+#include "GenomePacked.h"
 
-bool extendAlign( char* R, char* Q, char* G, uint rStart, uint gStart, int dR, int dG, uint L, uint Lprev, uint nMMprev, uint nMMmax, double pMMmax, Transcript* trA ) {
+static inline char extendGenomeBase(const char* G, const uint64* Gp, uint gStart, int dG, int i, uint32 &gLo, uint32 &gHi, uint32 &gMask) {
+    //genome base i of the extension; the packed genome is read 32 bases at a time, the bases have to be requested in order
+    if (Gp==NULL) return G[dG*i];
+    if ((i&31)==0) genomePackedLoad32(Gp, (int64) gStart+dG*i, dG<0, gLo, gHi, gMask);
+    return genomePackedWindowBase(gLo, gHi, gMask, (uint) (i&31));
+};
+
+bool extendAlign( char* R, char* Q, char* G, const uint64* Gp, uint rStart, uint gStart, int dR, int dG, uint L, uint Lprev, uint nMMprev, uint nMMmax, double pMMmax, Transcript* trA ) {
 
 // find the maximum score
     
-int iS,iG;
+int iS;
     
 int Score=0, nMatch=0, nMM=0;
 trA->maxScore=0;
 
+uint32 gLo=0, gHi=0, gMask=0;//32-base window of the packed genome, if it is loaded
+
 R=R+rStart;
 Q=Q+rStart;
 G=G+gStart;
@@ -21,9 +31,9 @@ if (pMMmax<0) {//end to end extension
     int iExt;
     for (iExt=0;iExt<(int) L;iExt++) {
         iS=dR*iExt;
-        iG=dG*iExt;
+        char g1=extendGenomeBase(G, Gp, gStart, dG, iExt, gLo, gHi, gMask);
 
-        if (G[iG]==5) {//prohibit extension through chr boundary
+        if (g1==5) {//prohibit extension through chr boundary
 //             trA->extendL=0;
 //             trA->maxScore=-999999999;
 //             trA->nMatch=0;
@@ -33,9 +43,9 @@ if (pMMmax<0) {//end to end extension
         };
         if (R[iS]==MARK_FRAG_SPACER_BASE) break; //no extension through the spacer between fragments
 
-        if (R[iS]>3 || G[iG]>3) continue;//no penalties for Ns in reads or genome
+        if (R[iS]>3 || g1>3) continue;//no penalties for Ns in reads or genome
 
-        if (G[iG]==R[iS]) {//Match
+        if (g1==R[iS]) {//Match
             nMatch++;
             Score += int(Q[iS]);
         } else {
@@ -59,12 +69,12 @@ if (pMMmax<0) {//end to end extension
 
 for (int i=0;i<(int) L;i++) {
     iS=dR*i;
-    iG=dG*i;
+    char g1=extendGenomeBase(G, Gp, gStart, dG, i, gLo, gHi, gMask);
     
-    if (G[iG]==5 || R[iS]==MARK_FRAG_SPACER_BASE) break; //no extension through chr boundary, or through the spacer between fragments
-    if (R[iS]>3 || G[iG]>3) continue;//no penalties for Ns in reads or genome
+    if (g1==5 || R[iS]==MARK_FRAG_SPACER_BASE) break; //no extension through chr boundary, or through the spacer between fragments
+    if (R[iS]>3 || g1>3) continue;//no penalties for Ns in reads or genome
     
-    if (G[iG]==R[iS]) {//Match
+    if (g1==R[iS]) {//Match
         nMatch++;        
         Score += int(Q[iS]);
         if (Score>trA->maxScore) {//record new maximum
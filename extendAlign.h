@@ -2,4 +2,4 @@
 #include "Parameters.h"
 #include "Transcript.h"
 
-bool extendAlign( char*, char*, char*, uint, uint, int, int, uint, uint, uint, uint, double, Transcript* );
+bool extendAlign( char*, char*, char*, const uint64*, uint, uint, int, int, uint, uint, uint, uint, double, Transcript* );
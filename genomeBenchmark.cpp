@@ -0,0 +1,159 @@
+#include "genomeBenchmark.h"
+#include "PackedArray.h"
+#include "ErrorWarning.h"
+#include "TimeFunctions.h"
+#include <omp.h>
+#include <iomanip>
+
+#define GENOME_BENCHMARK_SA_MAX (1LLU<<28) //SA elements copied into each layout
+#define GENOME_BENCHMARK_RANDOM_N (1LLU<<24) //random accesses
+#define GENOME_BENCHMARK_RANGE_N (1LLU<<20) //ranges of consecutive elements, as the SA ranges of the multimapping seeds
+#define GENOME_BENCHMARK_RANGE_L 16
+
+struct GenomeBenchmarkLayout {
+    string name;
+    uint wordBits;
+    PackedArray A;
+    double randomNs[3], rangeNs[4]; //generic shifts, operator[] dispatch, specialized accessor; decodeRange
+};
+
+static inline uint xorshift64(uint &x) {//fixed-seed generator: the same indices for all layouts and runs
+    x ^= x<<13;
+    x ^= x>>7;
+    x ^= x<<17;
+    return x;
+};
+
+template <uint wordBits> static uint benchmarkRandom(const PackedArray &A, const vector <uint> &ind) {
+    uint sum=0;
+    for (uint ii=0; ii<ind.size(); ii++) sum += A.get<wordBits>(ind[ii]);
+    return sum;
+};
+
+template <uint wordBits> static uint benchmarkRange(const PackedArray &A, const vector <uint> &start) {
+    uint sum=0;
+    for (uint ii=0; ii<start.size(); ii++) {
+        for (uint jj=start[ii]; jj<start[ii]+GENOME_BENCHMARK_RANGE_L; jj++) sum += A.get<wordBits>(jj);
+    };
+    return sum;
+};
+
+static uint benchmarkRandomDispatch(PackedArray &A, const vector <uint> &ind) {
+    uint sum=0;
+    for (uint ii=0; ii<ind.size(); ii++) sum += A[ind[ii]];
+    return sum;
+};
+
+static uint benchmarkRangeDispatch(PackedArray &A, const vector <uint> &start) {
+    uint sum=0;
+    for (uint ii=0; ii<start.size(); ii++) {
+        for (uint jj=start[ii]; jj<start[ii]+GENOME_BENCHMARK_RANGE_L; jj++) sum += A[jj];
+    };
+    return sum;
+};
+
+static uint benchmarkRangeDecode(const PackedArray &A, const vector <uint> &start) {
+    uint sum=0, a[GENOME_BENCHMARK_RANGE_L];
+    for (uint ii=0; ii<start.size(); ii++) {
+        A.decodeRange(start[ii], GENOME_BENCHMARK_RANGE_L, a);
+        for (uint jj=0; jj<GENOME_BENCHMARK_RANGE_L; jj++) sum += a[jj];
+    };
+    return sum;
+};
+
+template <uint wordBits> static void benchmarkLayout(GenomeBenchmarkLayout &lay, const vector <uint> &ind, const vector <uint> &start, uint sumRef[2], Parameters *P) {
+    uint sum[7];
+    double t[8];
+    t[0]=omp_get_wtime();
+    sum[0]=benchmarkRandom<PACKED_ARRAY_BITS_ANY>(lay.A, ind);
+    t[1]=omp_get_wtime();
+    sum[1]=benchmarkRandomDispatch(lay.A, ind);
+    t[2]=omp_get_wtime();
+    sum[2]=benchmarkRandom<wordBits>(lay.A, ind);
+    t[3]=omp_get_wtime();
+    sum[3]=benchmarkRange<PACKED_ARRAY_BITS_ANY>(lay.A, start);
+    t[4]=omp_get_wtime();
+    sum[4]=benchmarkRangeDispatch(lay.A, start);
+    t[5]=omp_get_wtime();
+    sum[5]=benchmarkRange<wordBits>(lay.A, start);
+    t[6]=omp_get_wtime();
+    sum[6]=benchmarkRangeDecode(lay.A, start);
+    t[7]=omp_get_wtime();
+
+    for (uint ii=0; ii<7; ii++) {//all accessors have to read the same values as the loaded SA
+        if (sum[ii]!=sumRef[ii<3 ? 0 : 1]) {
+            ostringstream errOut;
+            errOut << "EXITING because of FATAL BUG: SA layout " << lay.name << " returned different values than the loaded SA, test " << ii <<"\n";
+            errOut << "SOLUTION: please contact STAR author https://groups.google.com/forum/#!forum/rna-star\n" <<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_BUG, *P);
+        };
+    };
+    for (uint ii=0; ii<3; ii++) {
+        lay.randomNs[ii]=(t[ii+1]-t[ii])*1e9/ind.size();
+    };
+    for (uint ii=0; ii<4; ii++) {
+        lay.rangeNs[ii]=(t[ii+4]-t[ii+3])*1e9/(start.size()*GENOME_BENCHMARK_RANGE_L);
+    };
+};
+
+void genomeBenchmark(Parameters *P, Genome &mainGenome) {
+    time_t rawTime;
+    time(&rawTime);
+    P->inOut->logMain     << timeMonthDayTime(rawTime) <<" ... benchmarking the SA layouts\n" <<flush;
+    *P->inOut->logStdOut  << timeMonthDayTime(rawTime) <<" ... benchmarking the SA layouts\n" <<flush;
+
+    uint nSA=min(P->nSA, (uint) GENOME_BENCHMARK_SA_MAX);
+    if (nSA<=GENOME_BENCHMARK_RANGE_L) {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT ERROR: the SA is too short for the benchmark: " << nSA << " indices\n";
+        errOut << "SOLUTION: use a larger genome for --runMode genomeBenchmark\n" <<flush;
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+    };
+
+    vector <uint> ind(GENOME_BENCHMARK_RANDOM_N), start(GENOME_BENCHMARK_RANGE_N);
+    uint rng=0x9E3779B97F4A7C15LLU;
+    for (uint ii=0; ii<ind.size(); ii++) ind[ii]=xorshift64(rng)%nSA;
+    for (uint ii=0; ii<start.size(); ii++) start[ii]=xorshift64(rng)%(nSA-GENOME_BENCHMARK_RANGE_L);
+
+    uint sumRef[2]={0,0}; //values of the loaded SA
+    for (uint ii=0; ii<ind.size(); ii++) sumRef[0] += mainGenome.SA[ind[ii]];
+    for (uint ii=0; ii<start.size(); ii++) {
+        for (uint jj=start[ii]; jj<start[ii]+GENOME_BENCHMARK_RANGE_L; jj++) sumRef[1] += mainGenome.SA[jj];
+    };
+
+    vector <GenomeBenchmarkLayout> lay(3);
+    lay[0].name="Packed"; lay[0].wordBits=P->GstrandBit+1;
+    lay[1].name="40bit";  lay[1].wordBits=40;
+    lay[2].name="64bit";  lay[2].wordBits=64;
+    if (P->GstrandBit+1>40) lay.erase(lay.begin()+1); //the SA values do not fit
+
+    for (uint il=0; il<lay.size(); il++) {
+        PackedArray &A=lay[il].A;
+        A.defineBits(lay[il].wordBits, nSA);
+        A.charArray=new char[A.lengthByte+sizeof(uint)]; //the last element is read and written with 8-byte words
+        memset(A.charArray, 0, A.lengthByte+sizeof(uint));
+        for (uint ii=0; ii<nSA; ii++) A.writePacked(ii, mainGenome.SA[ii]);
+
+        switch (lay[il].wordBits) {
+            case 40: benchmarkLayout<40>(lay[il], ind, start, sumRef, P); break;
+            case 64: benchmarkLayout<64>(lay[il], ind, start, sumRef, P); break;
+            default: benchmarkLayout<PACKED_ARRAY_BITS_ANY>(lay[il], ind, start, sumRef, P);
+        };
+        delete [] A.charArray;
+    };
+
+    ostringstream report;
+    report << "SA layouts: " << nSA << " SA indices of " << P->nSA << ", " << ind.size() << " random accesses, " << start.size() << " ranges of " << GENOME_BENCHMARK_RANGE_L << " consecutive indices\n";
+    report << "access time in ns per index: generic = shifts for any word length, dispatch = operator[], specialized = get<wordBits>, decode = decodeRange\n";
+    report << setw(8) << "layout" << setw(6) << "bits" << setw(16) << "SA bytes" \
+           << setw(16) << "random:generic" << setw(10) << "dispatch" << setw(13) << "specialized" \
+           << setw(15) << "range:generic" << setw(10) << "dispatch" << setw(13) << "specialized" << setw(8) << "decode" << "\n";
+    report << fixed << setprecision(2);
+    for (uint il=0; il<lay.size(); il++) {
+        report << setw(8) << lay[il].name << setw(6) << lay[il].wordBits << setw(16) << P->nSA*lay[il].wordBits/8+1 \
+               << setw(16) << lay[il].randomNs[0] << setw(10) << lay[il].randomNs[1] << setw(13) << lay[il].randomNs[2] \
+               << setw(15) << lay[il].rangeNs[0] << setw(10) << lay[il].rangeNs[1] << setw(13) << lay[il].rangeNs[2] << setw(8) << lay[il].rangeNs[3] << "\n";
+    };
+    P->inOut->logMain << report.str() <<flush;
+    *P->inOut->logStdOut << report.str() <<flush;
+};
@@ -0,0 +1,10 @@
+#ifndef DEF_genomeBenchmark
+#define DEF_genomeBenchmark
+
+#include "IncludeDefine.h"
+#include "Parameters.h"
+#include "Genome.h"
+
+void genomeBenchmark(Parameters *P, Genome &mainGenome); //access cost and memory of the SA layouts, for the SA of the loaded genome
+
+#endif
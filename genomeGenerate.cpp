@@ -7,6 +7,9 @@
 #include "ErrorWarning.h"
 #include "loadGTF.h"
 #include "SjdbClass.h"
+#include "GenomeIndexFile.h"
+#include "GenomePacked.h"
+#include <unistd.h>
 
 #include "serviceFuns.cpp"
 #include "streamFuns.h"
@@ -150,6 +153,19 @@ void genomeGenerate(Parameters *P) {
         exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
     };
 
+    if (P->genomeSAlcp!="None" && P->genomeSAlcp!="Byte") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT PARAMETER ERROR: unrecognized option in --genomeSAlcp=" << P->genomeSAlcp << "\n";
+        errOut << "SOLUTION: use one of the allowed values of --genomeSAlcp : None or Byte\n";
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_PARAMETER, *P);
+    };
+
+    if (P->genomePacked!="None" && P->genomePacked!="2bit") {
+        ostringstream errOut;
+        errOut << "EXITING because of FATAL INPUT PARAMETER ERROR: unrecognized option in --genomePacked=" << P->genomePacked << "\n";
+        errOut << "SOLUTION: use one of the allowed values of --genomePacked : None or 2bit\n";
+        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_PARAMETER, *P);
+    };
     
     //time
     time_t rawTime;
@@ -179,6 +195,9 @@ void genomeGenerate(Parameters *P) {
     genomePar << "genomeSAindexNbases\t" << P->genomeSAindexNbases << endl;
     genomePar << "genomeChrBinNbits\t" << P->genomeChrBinNbits << endl;
     genomePar << "genomeSAsparseD\t" << P->genomeSAsparseD <<endl;
+    if (P->genomeSAlcp!="None") genomePar << "genomeSAlcp\t" << P->genomeSAlcp <<endl; //the defaults are not recorded: the genome stays readable by the previous versions
+    if (P->genomePacked!="None") genomePar << "genomePacked\t" << P->genomePacked <<endl;
+    if (P->genomeSAlayout!="Packed") genomePar << "genomeSAlayout\t" << P->genomeSAlayout <<endl;
     genomePar << "sjdbOverhang\t" << P->sjdbOverhang <<endl;
     genomePar << "sjdbFileChrStartEnd\t" << P->sjdbFileChrStartEnd <<endl;
     
@@ -469,12 +488,13 @@ void genomeGenerate(Parameters *P) {
     if (P->GstrandBit<32) P->GstrandBit=32; //TODO: use simple access function for SA
     
     P->GstrandMask = ~(1LLU<<P->GstrandBit);
-    P->nSAbyte=P->nSA*(P->GstrandBit+1)/8+1;
+    uint SAwordLength=genomeSAwordLength(P);
+    P->nSAbyte=P->nSA*SAwordLength/8+1;
     PackedArray SA1;    
-    SA1.defineBits(P->GstrandBit+1,P->nSA);
+    SA1.defineBits(SAwordLength,P->nSA);
         
     P->inOut->logMain  << "Number of SA indices: "<< P->nSA << endl<<flush;    
-    P->inOut->logMain  << "SA size in bytes: "<< P->nSAbyte << endl<<flush;
+    P->inOut->logMain  << "SA size in bytes: "<< P->nSAbyte << ", bits per index: " << SAwordLength << endl<<flush;
     
 
     //sort SA
@@ -647,10 +667,9 @@ void genomeGenerate(Parameters *P) {
         errOut << "         Will try to cut the file to a correct size and check the SA\n";
         errOut << "         Please report this error to dobin@cshl.edu\n";
         
-        ostringstream sysCom;
-        sysCom << "cd " <<P->genomeDir<<"; mv SA SA.old; head -c " << P->nSAbyte << " SA.old > SA; rm -f SA.old";
-        errOut << "         Executing system command: " <<sysCom.str() <<"\n";
-        system(sysCom.str().c_str());
+        if (truncate((P->genomeDir+("/SA")).c_str(), P->nSAbyte)!=0) {
+            errOut << "         truncate() failed: " << strerror(errno) <<"\n";
+        };
         
         *P->inOut->logStdOut <<errOut.str();
         P->inOut->logMain <<errOut.str();
@@ -812,6 +831,55 @@ void genomeGenerate(Parameters *P) {
     fstreamWriteBig(genomeOut, (char*) P->genomeSAindexStart, sizeof(P->genomeSAindexStart[0])*(P->genomeSAindexNbases+1));        
     fstreamWriteBig(genomeOut,  SAip.charArray, SAip.lengthByte);
     genomeOut.close();    
+
+    if (P->genomeSAlcp=="Byte") {//LCP of each suffix with the previous one, only A,C,G,T are counted
+        time(&rawTime);
+        P->inOut->logMain    << timeMonthDayTime(rawTime) <<" ... generating LCP array\n" <<flush;
+        *P->inOut->logStdOut << timeMonthDayTime(rawTime) <<" ... generating LCP array\n" <<flush;
+
+        uint8 *SAlcp=new uint8 [P->nSA];
+        SAlcp[0]=0;
+        #pragma omp parallel for num_threads(P->runThreadN) schedule(dynamic,1000000)
+        for (int64 isa=1; isa<(int64) P->nSA; isa++) {
+            uint g1=funG2strLocus(SA1[isa-1],N,P->GstrandBit,P->GstrandMask);
+            uint g2=funG2strLocus(SA1[isa],N,P->GstrandBit,P->GstrandMask);
+            uint jj=0;
+            while (jj<SA_LCP_MAX && G[g1+jj]==G[g2+jj] && G[g1+jj]<4) ++jj;
+            SAlcp[isa]=(uint8) jj;
+        };
+
+        genomeOut.open((P->genomeDir+("/SAlcp")).c_str());
+        if (genomeOut.fail()) {//
+            ostringstream errOut;
+            errOut << "FATAL ERROR: could not create output file=SAlcp, EXITING\n"<<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+        };
+        fstreamWriteBig(genomeOut, (char*) SAlcp, P->nSA);
+        genomeOut.close();
+        delete [] SAlcp;
+    };
+
+    if (P->genomePacked=="2bit") {//2-bit codes and the mask of the non-ACGT bases
+        time(&rawTime);
+        P->inOut->logMain    << timeMonthDayTime(rawTime) <<" ... generating packed genome\n" <<flush;
+        *P->inOut->logStdOut << timeMonthDayTime(rawTime) <<" ... generating packed genome\n" <<flush;
+
+        uint64 GpWords=genomePackedBlocks(P->nGenome)*GENOME_PACKED_BLOCK_WORDS;
+        uint64 *Gp=new uint64 [GpWords];
+        genomePackedFill(G, P->nGenome, Gp, P->runThreadN);
+
+        genomeOut.open((P->genomeDir+("/GenomePacked")).c_str());
+        if (genomeOut.fail()) {//
+            ostringstream errOut;
+            errOut << "FATAL ERROR: could not create output file=GenomePacked, EXITING\n"<<flush;
+            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+        };
+        fstreamWriteBig(genomeOut, (char*) Gp, GpWords*sizeof(uint64));
+        genomeOut.close();
+        delete [] Gp;
+    };
+
+    if (P->genomeIndexFile!="None") genomeIndexWrite(P); //all files are packed into the single-file index
     
     time(&rawTime);
     timeString=asctime(localtime ( &rawTime ));
@@ -1,70 +1,58 @@
 #include "readLoad.h"
 #include "ErrorWarning.h"
 
-int readLoad(istream& readInStream, Parameters* P, uint iMate, uint& Lread, uint& LreadOriginal, char* readName, char* Seq, char* SeqNum, char* Qual, char* QualNum, uint &clip3pNtotal, uint &clip5pNtotal, uint &clip3pAdapterN){
-    //load one read from a stream
-    int readFileType=0;
-    
-    readInStream.getline(readName,DEF_readNameLengthMax); //extract name
+static void errorNameLength(Parameters* P, uint nameLength, const string &readName) {
+    ostringstream errOut;
+    errOut << "EXITING because of FATAL ERROR in reads input: read name is too long:" << nameLength <<"\n";
+    errOut << "Read Name="<<readName<<"\n";
+    errOut << "DEF_readNameLengthMax="<<DEF_readNameLengthMax<<"\n";
+    errOut << "SOLUTION: increase DEF_readNameLengthMax in IncludeDefine.h and re-compile STAR\n";
+    exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+};
 
-    if (readInStream.gcount()<=1) {//end of the stream
-        return -1;
-    } else if (readInStream.gcount()>=DEF_readNameLengthMax-1) {
-        ostringstream errOut;
-        errOut << "EXITING because of FATAL ERROR in reads input: read name is too long:" << readInStream.gcount()<<"\n";
-        errOut << "Read Name="<<readName<<"\n";
-        errOut << "DEF_readNameLengthMax="<<DEF_readNameLengthMax<<"\n";
-        errOut << "SOLUTION: increase DEF_readNameLengthMax in IncludeDefine.h and re-compile STAR\n";
-        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);        
-    };    
-    
-    readInStream.getline(Seq,DEF_readSeqLengthMax+1); //extract sequence   
+static void errorSeqShort(Parameters* P, uint Lread, const char* readName, const string &Seq) {
+    ostringstream errOut;
+    errOut << "EXITING because of FATAL ERROR in reads input: short read sequence line: " << Lread <<"\n";
+    errOut << "Read Name="<<readName<<"\n";
+    errOut << "Read Sequence="<<Seq<<"===\n";
+    errOut << "DEF_readNameLengthMax="<<DEF_readNameLengthMax<<"\n";
+    errOut << "limitReadSeqLength="<<P->limitReadSeqLength<<"\n";
+    exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+};
 
-    Lread=(uint) readInStream.gcount();
-    if (Lread<=1) {
-        ostringstream errOut;
-        errOut << "EXITING because of FATAL ERROR in reads input: short read sequence line: " << Lread <<"\n";
-        errOut << "Read Name="<<readName<<"\n";
-        errOut << "Read Sequence="<<Seq<<"===\n";
-        errOut << "DEF_readNameLengthMax="<<DEF_readNameLengthMax<<"\n";
-        errOut << "DEF_readSeqLengthMax="<<DEF_readSeqLengthMax<<"\n";
-        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
-    };
-    --Lread;//do not count /n in the read length
-    LreadOriginal=Lread;
-    
-    if (Lread>DEF_readSeqLengthMax) {
-        ostringstream errOut;
-        errOut << "EXITING because of FATAL ERROR in reads input: Lread>=" << Lread << "   while DEF_readSeqLengthMax=" << DEF_readSeqLengthMax <<"\n";
-        errOut << "Read Name="<<readName<<"\n";
-        errOut << "SOLUTION: increase DEF_readSeqLengthMax in IncludeDefine.h and re-compile STAR\n";
-        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);         
-    };                        
+static void errorSeqLong(Parameters* P, uint Lread, const char* readName) {
+    ostringstream errOut;
+    errOut << "EXITING because of FATAL ERROR in reads input: Lread>=" << Lread << "   while limitReadSeqLength=" << P->limitReadSeqLength <<"\n";
+    errOut << "Read Name="<<readName<<"\n";
+    errOut << "SOLUTION: increase --limitReadSeqLength\n";
+    exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+};
 
-//     //was trying to read multi-line
-//     char nextChar='A';
-//     Lread=0;
-//     while (nextChar!='@' && nextChar!='>' && nextChar!='+' && nextChar!=' ' && nextChar!='\n' && !readInStream.eof()) {//read multi-line fasta
-//         readInStream.getline(Seq+Lread,DEF_readSeqLengthMax+1); //extract sequence   
-//         Lread+=(uint) readInStream.gcount() - 1;    //count chars in the sequence line, but do not read yet                          
-//         nextChar=readInStream.peek();        
-//     };
-//     if (Lread>DEF_readSeqLengthMax) {
-//         ostringstream errOut;
-//         errOut << "EXITING because of FATAL ERROR in reads input: Lread>=" << Lread << "   while DEF_readSeqLengthMax=" << DEF_readSeqLengthMax <<"\n";
-//         errOut << "Read Name="<<readName<<"\n";
-//         errOut << "SOLUTION: increase DEF_readSeqLengthMax in IncludeDefine.h and re-compile STAR\n";
-//         exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);        
-//     };     
-//     LreadOriginal=Lread;    
-    
+static void errorQualLength(Parameters* P, const char* readName, const string &Seq, const string &Qual) {
+    ostringstream errOut;
+    errOut << "EXITING because of FATAL ERROR in reads input: quality string length is not equal to sequence length\n";
+    errOut << readName<<"\n";
+    errOut << Seq <<"\n";
+    errOut << Qual <<"\n";
+    errOut << "SOLUTION: fix your fastq file\n";
+    exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+};
+
+static void errorFormat(Parameters* P, const char* readName) {
+    ostringstream errOut;
+    errOut <<"Unknown reads file format: header line does not start with @ or > : "<< readName<<"\n";
+    exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P);
+};
+
+static void readProcess(Parameters* P, uint iMate, int readFileType, uint& Lread, uint LreadOriginal, char* readName, char* Seq, char* SeqNum, char* Qual, char* QualNum, uint &clip3pNtotal, uint &clip5pNtotal, uint &clip3pAdapterN) {
+    //clip and convert the loaded read, prepare qualities, trim read name
     if ( Lread>(P->clip5pNbases[iMate]+P->clip3pNbases[iMate]) ) {
-        Lread=Lread-(P->clip5pNbases[iMate]+P->clip3pNbases[iMate]); 
+        Lread=Lread-(P->clip5pNbases[iMate]+P->clip3pNbases[iMate]);
     } else {
         Lread=0;
     };
     convertNucleotidesToNumbers(Seq+P->clip5pNbases[iMate],SeqNum,Lread);
-        
+
     //clip the adapter
     if (P->clip3pAdapterSeq.at(iMate).length()>0) {
         clip3pAdapterN = Lread-localSearch(SeqNum,Lread,P->clip3pAdapterSeqNum[iMate],P->clip3pAdapterSeq.at(iMate).length(),P->clip3pAdapterMMp[iMate]);
@@ -74,28 +62,16 @@ int readLoad(istream& readInStream, Parameters* P, uint iMate, uint& Lread, uint
     };
 
     //final read length, trim 3p after the adapter was clipped
-    if (Lread>P->clip3pAfterAdapterNbases[iMate]) {    
+    if (Lread>P->clip3pAfterAdapterNbases[iMate]) {
         Lread =Lread - P->clip3pAfterAdapterNbases[iMate];
     } else {
         Lread=0;
     };
-    
+
     clip3pNtotal=P->clip3pNbases[iMate] + clip3pAdapterN + P->clip3pAfterAdapterNbases[iMate];
     clip5pNtotal=P->clip5pNbases[iMate];
 
-    if (readName[0]=='@') {//fastq format, read qualities
-        readFileType=2;
-        readInStream.ignore(DEF_readNameLengthMax,'\n'); //extract header line   
-        readInStream.getline(Qual,DEF_readSeqLengthMax);//read qualities
-        if ((uint) readInStream.gcount() != LreadOriginal+1) {//inconsistent read sequence and quality
-            ostringstream errOut;            
-            errOut << "EXITING because of FATAL ERROR in reads input: quality string length is not equal to sequence length\n";
-            errOut << readName<<"\n";
-            errOut << Seq <<"\n";            
-            errOut << Qual <<"\n";
-            errOut << "SOLUTION: fix your fastq file\n";
-            exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P); 
-        };
+    if (readFileType==2) {//fastq format, convert qualities
         if (P->outQSconversionAdd!=0) {
             for (uint ii=0;ii<LreadOriginal;ii++) {
                 int qs=int(Qual[ii])+P->outQSconversionAdd;
@@ -107,17 +83,11 @@ int readLoad(istream& readInStream, Parameters* P, uint iMate, uint& Lread, uint
                 Qual[ii]=qs;
             };
         };
-        
-    } else if (readName[0]=='>') {//fasta format, assign Qtop to all qualities
-        readFileType=1;
+    } else {//fasta format, assign Qtop to all qualities
         for (uint ii=0;ii<LreadOriginal;ii++) Qual[ii]='A';
         Qual[LreadOriginal]=0;
-    } else {//header 
-        ostringstream errOut;
-        errOut <<"Unknown reads file format: header line does not start with @ or > : "<< readName<<"\n";
-        exitWithError(errOut.str(),std::cerr, P->inOut->logMain, EXIT_CODE_INPUT_FILES, *P); 
     };
-    
+
     for (uint ii=0;ii<Lread;ii++) {//for now: qualities are all 1
         if (SeqNum[ii]<4) {
             QualNum[ii]=1;
@@ -125,22 +95,110 @@ int readLoad(istream& readInStream, Parameters* P, uint iMate, uint& Lread, uint
             QualNum[ii]=0;
         };
     };
-            
+
 //     for (uint ii=0;ii<Lread;ii++) {//simply cut too high Qs
 //         QualNum[ii]=(Qual[ii+P->clip5pNbases[iMate]] > P->QasciiSubtract) ? (Qual[ii+P->clip5pNbases[iMate]] - P->QasciiSubtract) : 0; //substract QasciiSubtract
 //         QualNum[ii]=P->QSconv[(int) QualNum[ii]];
 //         QualNum[ii]=min(QualNum[ii], P->Qtop);//cut QSs at the Qtop
 // //         if (QualNum[ii]==2) QualNum[ii]=P->Qtop;
 //         if (SeqNum[ii]>3) QualNum[ii]=0; //QS=0 for Ns
-//         Qual1[1][Lread-ii-1]=QualNum[ii]; //reverse     
+//         Qual1[1][Lread-ii-1]=QualNum[ii]; //reverse
 //     };
-    
 
     //trim read name
     char* pSlash=strchr(readName,' '); //trim everything after ' '
-    if (pSlash!=NULL) *pSlash=0;                
+    if (pSlash!=NULL) *pSlash=0;
     pSlash=strchr(readName,'/'); //trim everything after /
-    if (pSlash!=NULL) *pSlash=0;    
-    
+    if (pSlash!=NULL) *pSlash=0;
+};
+
+int readLoad(istream& readInStream, Parameters* P, uint iMate, uint& Lread, uint& LreadOriginal, char* readName, char* Seq, char* SeqNum, char* Qual, char* QualNum, uint &clip3pNtotal, uint &clip5pNtotal, uint &clip3pAdapterN){
+    //load one read from a stream
+    int readFileType=0;
+
+    readInStream.getline(readName,DEF_readNameLengthMax); //extract name
+
+    if (readInStream.gcount()<=1) {//end of the stream
+        return -1;
+    } else if (readInStream.gcount()>=DEF_readNameLengthMax-1) {
+        errorNameLength(P, readInStream.gcount(), readName);
+    };
+
+    readInStream.getline(Seq,P->limitReadSeqLength+1); //extract sequence
+
+    Lread=(uint) readInStream.gcount();
+    if (Lread<=1) errorSeqShort(P, Lread, readName, Seq);
+    --Lread;//do not count /n in the read length
+    LreadOriginal=Lread;
+
+    if (Lread>P->limitReadSeqLength) errorSeqLong(P, Lread, readName);
+
+//     //was trying to read multi-line
+//     char nextChar='A';
+//     Lread=0;
+//     while (nextChar!='@' && nextChar!='>' && nextChar!='+' && nextChar!=' ' && nextChar!='\n' && !readInStream.eof()) {//read multi-line fasta
+//         readInStream.getline(Seq+Lread,P->limitReadSeqLength+1); //extract sequence
+//         Lread+=(uint) readInStream.gcount() - 1;    //count chars in the sequence line, but do not read yet
+//         nextChar=readInStream.peek();
+//     };
+//     LreadOriginal=Lread;
+
+    if (readName[0]=='@') {//fastq format, read qualities
+        readFileType=2;
+        readInStream.ignore(DEF_readNameLengthMax,'\n'); //extract header line
+        readInStream.getline(Qual,P->limitReadSeqLength);//read qualities
+        if ((uint) readInStream.gcount() != LreadOriginal+1) {//inconsistent read sequence and quality
+            errorQualLength(P, readName, Seq, Qual);
+        };
+    } else if (readName[0]=='>') {//fasta format
+        readFileType=1;
+    } else {//header
+        errorFormat(P, readName);
+    };
+
+    readProcess(P, iMate, readFileType, Lread, LreadOriginal, readName, Seq, SeqNum, Qual, QualNum, clip3pNtotal, clip5pNtotal, clip3pAdapterN);
+    return readFileType;
+};
+
+int readLoad(char* &readInChunk, Parameters* P, uint iMate, uint& Lread, uint& LreadOriginal, char* &readName, char* &Seq, char* SeqNum, char* &Qual, char* QualFasta, char* QualNum, uint &clip3pNtotal, uint &clip5pNtotal, uint &clip3pAdapterN){
+    //load one read from the chunk buffer: the lines are 0-terminated in place, name, sequence and quality point into the chunk
+    int readFileType=0;
+
+    readName=readInChunk;
+    char *lineEnd=(char*) memchr(readName,'\n',DEF_readNameLengthMax-2);
+    if (lineEnd==readName) {//empty line: end of the chunk
+        return -1;
+    } else if (lineEnd==NULL) {
+        errorNameLength(P, DEF_readNameLengthMax-1, string(readName,DEF_readNameLengthMax-2));
+    };
+    *lineEnd=0;
+
+    Seq=lineEnd+1;
+    lineEnd=(char*) memchr(Seq,'\n',P->limitReadSeqLength+1);
+    if (lineEnd==NULL) errorSeqLong(P, P->limitReadSeqLength+1, readName);
+    Lread=(uint) (lineEnd-Seq);
+    if (Lread==0) errorSeqShort(P, Lread+1, readName, "");
+    *lineEnd=0;
+    LreadOriginal=Lread;
+
+    if (readName[0]=='@') {//fastq format, quality line follows the + line
+        readFileType=2;
+        lineEnd=(char*) memchr(lineEnd+1,'\n',DEF_readNameLengthMax);
+        if (lineEnd==NULL) errorQualLength(P, readName, Seq, "");
+        Qual=lineEnd+1;
+        lineEnd=(char*) memchr(Qual,'\n',P->limitReadSeqLength+1);
+        if (lineEnd==NULL || (uint) (lineEnd-Qual) != LreadOriginal) {//inconsistent read sequence and quality
+            errorQualLength(P, readName, Seq, string(Qual, lineEnd==NULL ? P->limitReadSeqLength : lineEnd-Qual));
+        };
+        *lineEnd=0;
+    } else if (readName[0]=='>') {//fasta format, qualities are generated in a separate array
+        readFileType=1;
+        Qual=QualFasta;
+    } else {//header
+        errorFormat(P, readName);
+    };
+    readInChunk=lineEnd+1;
+
+    readProcess(P, iMate, readFileType, Lread, LreadOriginal, readName, Seq, SeqNum, Qual, QualNum, clip3pNtotal, clip5pNtotal, clip3pAdapterN);
     return readFileType;
 };
@@ -6,5 +6,6 @@
 #include "SequenceFuns.h"
 
 int readLoad(istream& readInStream, Parameters* P, uint iMate, uint& Lread, uint& readLengthPairOriginal, char* readName, char* Seq, char* SeqNum, char* Qual, char* QualNum, uint &clip3pNtotal, uint &clip5pNtotal, uint &clip3pAdapterN);
+int readLoad(char* &readInChunk, Parameters* P, uint iMate, uint& Lread, uint& LreadOriginal, char* &readName, char* &Seq, char* SeqNum, char* &Qual, char* QualFasta, char* QualNum, uint &clip3pNtotal, uint &clip5pNtotal, uint &clip3pAdapterN);
 
 #endif
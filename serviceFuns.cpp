@@ -26,5 +26,20 @@ inline int funCompareUint2 (const void *a, const void *b) {
 	};
 };
 
+template <class arrayType, int arraySize>
+inline int funCompareArrays (const void *a, const void *b) {
+    arrayType* va= (arrayType*) a;
+    arrayType* vb= (arrayType*) b;
+
+    for (int ii=0;ii<arraySize;ii++) {
+        if (va[ii]>vb[ii]) {
+            return 1;
+        } else if (va[ii]<vb[ii]) {
+            return -1;
+        };
+    };
+    return 0;
+};
+
 #endif
 
@@ -5,7 +5,7 @@
 #include "binarySearch2.h"
 // #include "stitchGapIndel.cpp"
 
-intScore stitchAlignToTranscript(uint rAend, uint gAend, uint rBstart, uint gBstart, uint L, uint iFragB, uint sjAB, Parameters* P, char* R, char* Q, char* G,  Transcript *trA) {
+intScore stitchAlignToTranscript(uint rAend, uint gAend, uint rBstart, uint gBstart, uint L, uint iFragB, uint sjAB, Parameters* P, char* R, char* Q, char* G, const uint64* Gp, Transcript *trA) {
     //stitch together A and B, extend in the gap, returns max score
     //Q is assumed modified already
 
@@ -17,6 +17,7 @@ intScore stitchAlignToTranscript(uint rAend, uint gAend, uint rBstart, uint gBst
         if (P->sjdbMotif[sjAB]==0 && (L<=P->sjdbShiftRight[sjAB] || trA->exons[trA->nExons-1][EX_L]<=P->sjdbShiftLeft[sjAB]) ) {
             return -100006; //too large repeats around non-canonical junction
         };
+        if (trA->nExons>=Transcript::nExonsMax) return -100007; //no space for another exon
         trA->exons[trA->nExons][EX_L] = L; //new exon length
         trA->exons[trA->nExons][EX_R] = rBstart; //new exon r-start
         trA->exons[trA->nExons][EX_G] = gBstart; //new exon g-start
@@ -282,15 +283,11 @@ intScore stitchAlignToTranscript(uint rAend, uint gAend, uint rBstart, uint gBst
 
             
             
-        #ifdef COMPILE_FOR_LONG_READS
-            if ( Score>0 && (trA->nMM + nMM)<=min(P->outFilterMismatchNmax, (uint) int(P->outFilterMismatchNoverLmax*trA->Lread)) )
-//             if ( Score>0 && nMM<=200 )
-                
-        #else
+            if ( (Del>0 || Ins>0) && trA->nExons>=Transcript::nExonsMax ) Score=-100007; //no space for another exon
+
             if ( Score>0 && (trA->nMM + nMM)<=min(P->outFilterMismatchNmax, (uint) int(P->outFilterMismatchNoverLmax*trA->Lread)) \
-                         && (nMM==0 || jCan<0 || jCan==1 || jCan==2) ) 
-        #endif
-            {//stitching worked only if there no mis-matches for non-GT/AG junctions
+                         && (P->alignLongReads==1 || nMM==0 || jCan<0 || jCan==1 || jCan==2) ) 
+            {//stitching worked only if there no mis-matches for non-GT/AG junctions (allowed for long reads)
                 trA->nMM += nMM;
                 trA->nMatch += nMatch;
 
@@ -329,6 +326,7 @@ intScore stitchAlignToTranscript(uint rAend, uint gAend, uint rBstart, uint gBst
             if (P->alignMatesGapMax>0 && gBstart > trA->exons[trA->nExons-1][EX_G] + trA->exons[trA->nExons-1][EX_L] + P->alignMatesGapMax) {
                 return -100004; //gap between mates too large
             };
+            if (trA->nExons>=Transcript::nExonsMax) return -100007; //no space for another exon
             //extend the fragments inside
             //note, that this always works, i.e. Score>0
 
@@ -346,7 +344,7 @@ intScore stitchAlignToTranscript(uint rAend, uint gAend, uint rBstart, uint gBst
 
             
             trExtend.reset();
-            if ( extendAlign(R, Q, G, rAend+1, gAend+1, 1, 1, DEF_readSeqLengthMax, trA->nMatch, trA->nMM, P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trExtend) ) {
+            if ( extendAlign(R, Q, G, Gp, rAend+1, gAend+1, 1, 1, P->limitReadSeqLength, trA->nMatch, trA->nMM, P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trExtend) ) {
 
                 trA->add(&trExtend);
                 Score += trExtend.maxScore;
@@ -360,7 +358,7 @@ intScore stitchAlignToTranscript(uint rAend, uint gAend, uint rBstart, uint gBst
             trA->nMatch += L;
 
             trExtend.reset();
-            if ( extendAlign(R, Q, G, rBstart-1, gBstart-1, -1, -1, gBstart-trA->exons[0][EX_G]+trA->exons[0][EX_R], trA->nMatch, trA->nMM, P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trExtend) ) {
+            if ( extendAlign(R, Q, G, Gp, rBstart-1, gBstart-1, -1, -1, gBstart-trA->exons[0][EX_G]+trA->exons[0][EX_R], trA->nMatch, trA->nMM, P->outFilterMismatchNmax, P->outFilterMismatchNoverLmax1, &trExtend) ) {
 
                 trA->add(&trExtend);
                 Score += trExtend.maxScore;               
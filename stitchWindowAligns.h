@@ -5,8 +5,8 @@
 #include "stitchAlignToTranscript.h"
 #include "ReadAlign.h"
 
-void stitchWindowAligns(uint iA, uint nA, int Score, bool WAincl[], uint tR2, uint tG2, Transcript trA, \
-                        uint Lread, uiWA* WA, char* R, char* Q, char* G, char* sigG,\
+void stitchWindowAligns(uint nA, bool WAincl[], const Transcript &trInit, \
+                        uint Lread, uiWA* WA, char* R, char* Q, char* G,\
                         Parameters* P, Transcript** wTr, uint* nWinTr, ReadAlign *RA);
-    //recursively stitch aligns for one gene
+    //stitch aligns for one gene, starting from the transcript trInit, iteratively with the stack RA->stitchStack
     //*nWinTr - number of transcripts for the current window